@@ -0,0 +1,190 @@
+//===================================
+//Grid A* and Jump Point Search engines
+//  - A*, either 4-connected with the Manhattan heuristic, or 8-connected (never cutting a block's corner) with the octile heuristic
+//  - Jump Point Search, 8-connected like the latter, which only expands the jump points of uniform-cost straight and diagonal runs
+//Like the branch engine, reaching the find or any position N/E/S/W of it is success
+//Both are complete and optimal: they never time out, and report no path only when there is none
+//===================================
+#ifndef ASTAR_H
+#define ASTAR_H
+
+#include <vector> //For the open heap and the path
+#include <algorithm> //For the open heap
+#include "grid.h" //For BitGrid and TiledGrid
+
+const uint STRAIGHT = 70; //Cost of a straight move
+const uint DIAGONAL = 99; //Cost of a diagonal move (~70 * sqrt(2))
+const int dirY[8] = {-1, 0, 1, 0, -1, 1, 1, -1}; //N, E, S, W, then NE, SE, SW, NW
+const int dirX[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+
+struct AStarCell
+{
+    uint gen; //Search this cell was last reached in; any other search sees it unreached
+    uint g; //Cost from the start
+    uint py; //Parent (the previous jump point, for Jump Point Search)
+    uint px;
+    bool closed;
+};
+
+struct OpenNode
+{
+    uint f;
+    uint g;
+    uint y;
+    uint x;
+    bool operator>(const OpenNode& o) const { return f != o.f ? f > o.f : g < o.g; } //Prefer the deeper of equal nodes
+};
+
+class AStar
+{
+  public:
+    const BitGrid& board;
+    TiledGrid<AStarCell> cells;
+    std::vector<OpenNode> open;
+    uint gen;
+    uint expanded; //Nodes expanded in the last search
+    Coord find;
+    bool diagonal;
+
+    AStar(const BitGrid&);
+    bool search(Coord, Coord, bool, bool, std::vector<Coord>&); //Search from start to find, 8-connected or not, jumping or not, giving the path from start to (next to) the find
+
+  private:
+    bool walkable(uint y, uint x) const { return y < board.h && x < board.w && !board.get(y, x); }
+    bool isGoal(uint y, uint x) const { return adjacentTo(y, x, find.y, find.x); }
+    uint heuristic(uint, uint) const;
+    void reach(uint, uint, uint, uint, uint); //Reach a cell from a parent at some cost, opening it if that is the cheapest way yet
+    uint jump(uint, uint, int, int, uint&, uint&); //Jump from a cell in a direction, giving the jump point (returning its step count, or 0 if none)
+    void buildPath(uint, uint, Coord, std::vector<Coord>&);
+};
+
+AStar::AStar(const BitGrid& Board) : board(Board), gen(0), expanded(0) {}
+
+uint AStar::heuristic(uint y, uint x) const //Cost to the find, less a straight move as we only need to get next to it
+{
+    uint dy = y > find.y ? y - find.y : find.y - y;
+    uint dx = x > find.x ? x - find.x : find.x - x;
+    uint h;
+    if (diagonal)
+    {
+        uint lo = std::min(dy, dx), hi = std::max(dy, dx);
+        h = lo * DIAGONAL + (hi - lo) * STRAIGHT; //Octile
+    } else {
+        h = (dy + dx) * STRAIGHT; //Manhattan
+    }
+    return h > STRAIGHT ? h - STRAIGHT : 0;
+}
+
+void AStar::reach(uint y, uint x, uint py, uint px, uint g)
+{
+    AStarCell& c = cells.at(y, x);
+    if (c.gen == gen && (c.closed || c.g <= g)) { return; }
+    c.gen = gen;
+    c.g = g;
+    c.py = py;
+    c.px = px;
+    c.closed = false;
+    open.push_back({g + heuristic(y, x), g, y, x});
+    std::push_heap(open.begin(), open.end(), std::greater<OpenNode>());
+}
+
+uint AStar::jump(uint y, uint x, int dy, int dx, uint& jy, uint& jx)
+{
+    for (uint n = 1; ; n++)
+    {
+        if (dy && dx && !(walkable(y + dy, x) && walkable(y, x + dx))) { return 0; } //Never cut a corner
+        y += dy;
+        x += dx;
+        if (!walkable(y, x)) { return 0; }
+        jy = y;
+        jx = x;
+        if (isGoal(y, x)) { return n; }
+        if (dy && dx) //Diagonal: a jump point if either of its straight runs leads to one
+        {
+            uint ty, tx;
+            if (jump(y, x, dy, 0, ty, tx) || jump(y, x, 0, dx, ty, tx)) { return n; }
+        } else if (dx) { //Horizontal: a jump point if a block behind us above or below has just ended
+            if ((walkable(y - 1, x) && !walkable(y - 1, x - dx)) || (walkable(y + 1, x) && !walkable(y + 1, x - dx))) { return n; }
+        } else { //Vertical: likewise to the left or right
+            if ((walkable(y, x - 1) && !walkable(y - dy, x - 1)) || (walkable(y, x + 1) && !walkable(y - dy, x + 1))) { return n; }
+        }
+    }
+}
+
+void AStar::buildPath(uint y, uint x, Coord start, std::vector<Coord>& path) //Walk the parents back from the end, filling in the runs between jump points
+{
+    path.clear();
+    while (true)
+    {
+        path.push_back({y, x});
+        if (y == start.y && x == start.x) { break; }
+        const AStarCell& c = cells.at(y, x);
+        int dy = c.py > y ? 1 : (c.py < y ? -1 : 0), dx = c.px > x ? 1 : (c.px < x ? -1 : 0);
+        while (y + dy != c.py || x + dx != c.px)
+        {
+            y += dy;
+            x += dx;
+            path.push_back({y, x});
+        }
+        y = c.py;
+        x = c.px;
+    }
+    std::reverse(path.begin(), path.end());
+}
+
+bool AStar::search(Coord start, Coord Find, bool Diagonal, bool jumping, std::vector<Coord>& path)
+{
+    find = Find;
+    diagonal = Diagonal || jumping;
+    expanded = 0;
+    path.clear();
+    if (cells.h != board.h || cells.w != board.w) { cells.resize(board.h, board.w); gen = 0; }
+    if (!++gen) { cells.clear(); gen = 1; } //Wrapped: forget every earlier search
+    open.clear();
+    reach(start.y, start.x, start.y, start.x, 0);
+    while (!open.empty())
+    {
+        OpenNode o = open.front();
+        std::pop_heap(open.begin(), open.end(), std::greater<OpenNode>());
+        open.pop_back();
+        AStarCell& c = cells.at(o.y, o.x);
+        if (c.closed || c.g != o.g) { continue; } //Stale
+        c.closed = true;
+        expanded++;
+        if (isGoal(o.y, o.x))
+        {
+            buildPath(o.y, o.x, start, path);
+            return true;
+        }
+        uint dirs = diagonal ? 8 : 4;
+        for (uint d = 0; d < dirs; d++)
+        {
+            if (jumping && (o.y != start.y || o.x != start.x)) //Prune to the natural and forced neighbours, given the way we came in
+            {
+                int iy = o.y > c.py ? 1 : (o.y < c.py ? -1 : 0), ix = o.x > c.px ? 1 : (o.x < c.px ? -1 : 0);
+                if (iy && ix) //Diagonal: on along it, or either of its straight parts
+                {
+                    if (!((dirY[d] == iy && dirX[d] == ix) || (dirY[d] == iy && !dirX[d]) || (!dirY[d] && dirX[d] == ix))) { continue; }
+                } else { //Straight: on along it, turning aside, or diagonally forward
+                    if (dirY[d] == -iy && dirX[d] == -ix) { continue; }
+                    if (dirY[d] && dirX[d] && dirY[d] != iy && dirX[d] != ix) { continue; }
+                }
+            }
+            uint ny, nx, steps;
+            if (jumping)
+            {
+                if (!(steps = jump(o.y, o.x, dirY[d], dirX[d], ny, nx))) { continue; }
+            } else {
+                steps = 1;
+                ny = o.y + dirY[d];
+                nx = o.x + dirX[d];
+                if (!walkable(ny, nx)) { continue; }
+                if (d >= 4 && !(walkable(o.y + dirY[d], o.x) && walkable(o.y, o.x + dirX[d]))) { continue; } //Never cut a corner
+            }
+            reach(ny, nx, o.y, o.x, o.g + steps * (d < 4 ? STRAIGHT : DIAGONAL));
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,368 @@
+//===================================
+//Many agents moving on one board at once, without running into each other (Windowed Hierarchical Cooperative A*)
+//  - Every agent's plan is written into a shared space-time reservation table: which agent will stand in which cell at which tick
+//  - An agent plans with A* over cells and ticks, WINDOW ticks ahead, around the cells others have reserved. It may wait,
+//    and may not swap cells with another agent in one tick. Waiting on its goal is free, so an agent at rest stays put
+//  - Beyond the window, the plan is guided by the agent's true distance to its goal, ignoring other agents.
+//    That comes from a resumable A* out from the goal (Reverse Resumable A*), which only searches as far as the agent asks it to
+//  - Plans are redone every few ticks (replanEvery), a few agents at a time, each against the plans of the rest;
+//    so agents take turns being first, and no plan outlives its window
+//  - An agent boxed in by others' plans stands still, and takes its cell back from them: they plan again before anyone moves.
+//    An agent walled off from its goal only keeps out of the others' way
+//Moves are 4-connected, and an agent may leave a block it starts on, as in every engine
+//A goal on a block is approached as near as the agent can get
+//===================================
+#ifndef AGENTS_H
+#define AGENTS_H
+
+#include <vector> //For agents, plans and open heaps
+#include <algorithm> //For the open heaps
+#include <unordered_map> //For the reservation table and the space-time search
+#include <stdint.h> //For uint64_t
+#include "grid.h" //For BitGrid and TiledGrid
+#include "aStar.h" //For directions
+#include "replanner.h" //For INF
+
+const uint WINDOW = 16; //Ticks a plan looks ahead, by default
+const uint NOBODY = (uint)-1; //The owner of an unreserved cell
+const uint REPLANPASSES = 16; //Most times in a tick that agents made to give way may plan again
+
+struct DistanceCell
+{
+    uint g; //Steps from the goal
+    byte state; //0 unreached, 1 open, 2 closed
+};
+
+class TrueDistance //Steps from every cell to a goal, found only as far as they are asked for
+{
+  public:
+    const BitGrid& board;
+    Coord goal;
+    Coord toward; //The search heads for here, so the cells an agent asks about first are found soonest
+    TiledGrid<DistanceCell> cells;
+    std::vector<OpenNode> open;
+    uint expanded; //In total, since the last reset
+
+    TrueDistance(const BitGrid&);
+    void reset(Coord, Coord); //Start again for a goal, heading toward an agent
+    uint distance(uint, uint); //Of a cell from the goal, going on with the search if need be, or INF
+    bool reached(uint y, uint x) const { return cells.get(y, x).state != 0; }
+
+  private:
+    uint heuristic(uint y, uint x) const { return (y > toward.y ? y - toward.y : toward.y - y) + (x > toward.x ? x - toward.x : toward.x - x); }
+    TrueDistance(const TrueDistance&);
+    TrueDistance& operator=(const TrueDistance&);
+};
+
+struct Agent
+{
+    Coord pos;
+    Coord goal;
+    std::vector<Coord> plan; //Where the agent stands from plannedAt on, a tick per cell
+    uint plannedAt; //Tick the plan begins at
+    bool stale; //Plan again at the next tick whatever replanEvery says
+    TrueDistance* dist;
+};
+
+class Crowd
+{
+  public:
+    const BitGrid& board;
+    std::vector<Agent> agents;
+    uint window; //Ticks each plan looks ahead
+    uint replanEvery; //Ticks between an agent's plans (at most the window)
+    uint tick;
+  //Counts, since the crowd was made
+    uint64_t replans;
+    uint64_t expanded; //Space-time nodes
+    uint64_t blocked; //Plans that found no way on, so stood still
+
+    Crowd(const BitGrid&, uint = WINDOW, uint = 0); //Board, window, replanEvery (0 for half the window)
+    ~Crowd();
+    uint add(Coord, Coord); //An agent at a start, heading for a goal, returning its index
+    void setGoal(uint, Coord);
+    void step(); //Plan those agents that are due, then move every agent on a tick
+    bool arrived(uint a) const { return agents[a].pos.y == agents[a].goal.y && agents[a].pos.x == agents[a].goal.x; }
+    uint owner(uint, uint, uint) const; //Agent reserving a cell at a tick, or NOBODY
+    void cellChanged(uint, uint); //A cell of the board has been blocked or cleared
+    void boardChanged(); //The board has been replaced or resized
+
+  private:
+    struct TimeNode
+    {
+        uint y;
+        uint x;
+        uint t; //Ticks after the plan's start
+        uint g;
+        uint parent; //Index, or NOBODY
+        bool closed;
+    };
+    std::unordered_map<uint64_t, uint> reserved; //Tick and cell, to agent
+    std::vector<std::vector<uint64_t> > holds; //Keys each agent has reserved
+    std::vector<TimeNode> nodes; //Of the space-time search
+    std::unordered_map<uint64_t, uint> nodeAt; //Tick and cell, to node
+    std::vector<OpenNode> open; //With y as the node's index
+
+    uint64_t key(uint t, uint y, uint x) const { return (uint64_t)t << 32 | (y * board.w + x); }
+    void plan(uint);
+    bool search(uint, std::vector<Coord>&);
+    void release(uint);
+    void reserve(uint);
+    void standStill(uint);
+    Crowd(const Crowd&);
+    Crowd& operator=(const Crowd&);
+};
+
+TrueDistance::TrueDistance(const BitGrid& Board) : board(Board), cells(Board.h, Board.w), expanded(0) {}
+
+void TrueDistance::reset(Coord Goal, Coord Toward)
+{
+    goal = Goal;
+    toward = Toward;
+    if (cells.h != board.h || cells.w != board.w) { cells.resize(board.h, board.w); } else { cells.clear(); }
+    open.clear();
+    expanded = 0;
+    DistanceCell& c = cells.at(goal.y, goal.x);
+    c.g = 0;
+    c.state = 1;
+    open.push_back({heuristic(goal.y, goal.x), 0, goal.y, goal.x});
+}
+
+uint TrueDistance::distance(uint y, uint x)
+{
+    if (cells.get(y, x).state == 2) { return cells.get(y, x).g; }
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), std::greater<OpenNode>());
+        OpenNode n = open.back();
+        open.pop_back();
+        DistanceCell& c = cells.at(n.y, n.x);
+        if (c.state == 2 || n.g != c.g) { continue; } //Stale
+        c.state = 2;
+        expanded++;
+        for (uint d = 0; d < 4; d++)
+        {
+            uint ny = n.y + dirY[d], nx = n.x + dirX[d];
+            if (ny >= board.h || nx >= board.w || board.get(ny, nx)) { continue; }
+            DistanceCell& m = cells.at(ny, nx);
+            if (m.state && m.g <= n.g + 1) { continue; }
+            m.g = n.g + 1;
+            m.state = 1;
+            open.push_back({m.g + heuristic(ny, nx), m.g, ny, nx});
+            std::push_heap(open.begin(), open.end(), std::greater<OpenNode>());
+        }
+        if (n.y == y && n.x == x) { return n.g; }
+    }
+    return INF; //Walled off from the goal
+}
+
+Crowd::Crowd(const BitGrid& Board, uint Window, uint ReplanEvery) : board(Board), window(std::max(1u, Window)), tick(0), replans(0), expanded(0), blocked(0)
+{
+    replanEvery = ReplanEvery ? std::min(ReplanEvery, window) : std::max(1u, window / 2);
+}
+
+Crowd::~Crowd()
+{
+    for (uint a = 0; a < agents.size(); a++) { delete agents[a].dist; }
+}
+
+uint Crowd::add(Coord start, Coord goal)
+{
+    Agent a;
+    a.pos = start;
+    a.goal = goal;
+    a.plan.assign(1, start);
+    a.plannedAt = tick;
+    a.stale = true;
+    a.dist = new TrueDistance(board);
+    a.dist->reset(goal, start);
+    agents.push_back(a);
+    holds.push_back(std::vector<uint64_t>());
+    reserve(agents.size() - 1); //Hold its cell until it plans
+    return agents.size() - 1;
+}
+
+void Crowd::setGoal(uint a, Coord goal)
+{
+    agents[a].goal = goal;
+    agents[a].dist->reset(goal, agents[a].pos);
+    agents[a].stale = true;
+}
+
+uint Crowd::owner(uint t, uint y, uint x) const
+{
+    std::unordered_map<uint64_t, uint>::const_iterator it = reserved.find(key(t, y, x));
+    return it == reserved.end() ? NOBODY : it->second;
+}
+
+void Crowd::step()
+{
+  //Plan those that are due, starting from a different agent each tick so none is always planned last; then those made to give way
+    uint n = agents.size();
+    bool planned = true;
+    for (uint pass = 0; pass < REPLANPASSES && planned; pass++)
+    {
+        planned = false;
+        for (uint i = 0; i < n; i++)
+        {
+            uint a = (tick + i) % n;
+            if (agents[a].stale || tick - agents[a].plannedAt >= replanEvery) { plan(a); planned = true; }
+        }
+    }
+    tick++;
+    for (uint a = 0; a < n; a++)
+    {
+        Agent& ag = agents[a];
+        ag.pos = ag.plan[std::min((size_t)(tick - ag.plannedAt), ag.plan.size() - 1)];
+    }
+}
+
+void Crowd::plan(uint a)
+{
+    Agent& ag = agents[a];
+    release(a);
+    replans++;
+    ag.plannedAt = tick;
+    ag.stale = false;
+    if (!search(a, ag.plan)) { standStill(a); }
+    reserve(a);
+}
+
+void Crowd::standStill(uint a) //Nowhere to go: take back the agent's cell from those planning to pass through it
+{
+    Agent& ag = agents[a];
+    ag.plan.assign(1, ag.pos);
+    blocked++;
+    for (uint t = 1; t <= window; t++)
+    {
+        std::unordered_map<uint64_t, uint>::iterator it = reserved.find(key(tick + t, ag.pos.y, ag.pos.x));
+        if (it == reserved.end()) { continue; }
+        agents[it->second].stale = true;
+        reserved.erase(it);
+    }
+}
+
+void Crowd::release(uint a)
+{
+    std::vector<uint64_t>& held = holds[a];
+    for (uint i = 0; i < held.size(); i++)
+    {
+        std::unordered_map<uint64_t, uint>::iterator it = reserved.find(held[i]);
+        if (it != reserved.end() && it->second == a) { reserved.erase(it); }
+    }
+    held.clear();
+}
+
+void Crowd::reserve(uint a) //Everywhere the plan stands, and its last cell to the end of the window
+{
+    Agent& ag = agents[a];
+    for (uint t = 0; t <= window; t++)
+    {
+        Coord c = ag.plan[std::min((size_t)t, ag.plan.size() - 1)];
+        uint64_t k = key(ag.plannedAt + t, c.y, c.x);
+        if (reserved.insert(std::make_pair(k, a)).second) { holds[a].push_back(k); }
+    }
+}
+
+bool Crowd::search(uint a, std::vector<Coord>& path) //A* over cells and ticks, to the end of the window
+{
+    Agent& ag = agents[a];
+    TrueDistance& dist = *ag.dist;
+    nodes.clear();
+    nodeAt.clear();
+    open.clear();
+    uint h0 = board.get(ag.pos.y, ag.pos.x) ? 0 : dist.distance(ag.pos.y, ag.pos.x); //A block is only left, so its distance is never needed
+    bool lost = h0 == INF; //Walled off from the goal: just keep out of the way
+    if (lost) { h0 = 0; }
+    nodes.push_back({ag.pos.y, ag.pos.x, 0, 0, NOBODY, false});
+    nodeAt[key(0, ag.pos.y, ag.pos.x)] = 0;
+    open.push_back({h0, 0, 0, 0});
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), std::greater<OpenNode>());
+        uint i = open.back().y;
+        open.pop_back();
+        if (nodes[i].closed) { continue; }
+        nodes[i].closed = true;
+        expanded++;
+        TimeNode n = nodes[i];
+        if (n.t == window)
+        {
+            path.resize(window + 1);
+            for (uint j = i; j != NOBODY; j = nodes[j].parent) { path[nodes[j].t] = {nodes[j].y, nodes[j].x}; }
+            return true;
+        }
+        uint now = tick + n.t;
+        for (uint d = 0; d < 5; d++) //N, E, S, W, then wait
+        {
+            uint ny = n.y, nx = n.x;
+            if (d < 4)
+            {
+                ny += dirY[d];
+                nx += dirX[d];
+                if (ny >= board.h || nx >= board.w || board.get(ny, nx)) { continue; }
+            }
+            uint other = owner(now + 1, ny, nx);
+            if (other != NOBODY && other != a) { continue; } //Taken
+            if (d < 4)
+            {
+                other = owner(now, ny, nx);
+                if (other != NOBODY && other != a && owner(now + 1, n.y, n.x) == other) { continue; } //Swapping with it
+            }
+            uint h = lost ? 0 : dist.distance(ny, nx);
+            if (h == INF) { continue; }
+            uint g = n.g + (d == 4 && h == 0 ? 0 : 1); //Waiting on the goal is free
+            uint64_t k = key(n.t + 1, ny, nx);
+            std::unordered_map<uint64_t, uint>::iterator it = nodeAt.find(k);
+            if (it != nodeAt.end())
+            {
+                TimeNode& m = nodes[it->second];
+                if (m.closed || m.g <= g) { continue; }
+                m.g = g;
+                m.parent = i;
+                open.push_back({g + h, g, it->second, 0});
+            } else {
+                nodeAt[k] = nodes.size();
+                open.push_back({g + h, g, (uint)nodes.size(), 0});
+                nodes.push_back({ny, nx, n.t + 1, g, i, false});
+            }
+            std::push_heap(open.begin(), open.end(), std::greater<OpenNode>());
+        }
+    }
+    return false; //Boxed in by other agents
+}
+
+void Crowd::cellChanged(uint y, uint x)
+{
+  //Distances that may have used the cell, or may now go through it, are found again
+    bool blocking = board.get(y, x);
+    for (uint a = 0; a < agents.size(); a++)
+    {
+        Agent& ag = agents[a];
+        bool near = ag.dist->reached(y, x);
+        for (uint d = 0; d < 4 && !near && !blocking; d++)
+        {
+            uint ny = y + dirY[d], nx = x + dirX[d];
+            near = ny < board.h && nx < board.w && ag.dist->reached(ny, nx);
+        }
+        if (near) { ag.dist->reset(ag.goal, ag.pos); ag.stale = true; }
+        for (uint t = 0; t < ag.plan.size() && blocking && !ag.stale; t++) { ag.stale = ag.plan[t].y == y && ag.plan[t].x == x; }
+    }
+}
+
+void Crowd::boardChanged()
+{
+    reserved.clear();
+    for (uint a = 0; a < agents.size(); a++)
+    {
+        Agent& ag = agents[a];
+        holds[a].clear();
+        ag.plan.assign(1, ag.pos);
+        ag.plannedAt = tick;
+        ag.dist->reset(ag.goal, ag.pos);
+        ag.stale = true;
+        reserve(a);
+    }
+}
+
+#endif
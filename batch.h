@@ -0,0 +1,195 @@
+//===================================
+//Solving many queries on one board at once, across a pool of threads
+//  - Each worker owns a PathFinder (and so all of its scratch grids); the board is shared, and only read
+//  - A batch is split into a contiguous run of queries per worker; a worker takes from the front of its own run,
+//    and once that is empty steals the back half of the fullest other run
+//  - Results come back in the order the queries were given
+//The board must not be changed while a batch is being solved
+//===================================
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector> //For queries and results
+#include <thread> //For the workers
+#include <mutex> //For the runs of queries, and waking workers
+#include <condition_variable> //For waking workers, and waiting for them
+#include <chrono> //For timing each query
+#include "pathFinder.h" //For PathFinder
+
+struct Query
+{
+    Coord start;
+    Coord find;
+};
+
+class BatchSolver
+{
+  public:
+    BatchSolver(const BitGrid&, uint = 0, uint = BRANCHMAX); //Board, threads (0 for one per core), branch pool size per worker
+    ~BatchSolver();
+    void solve(const std::vector<Query>&, std::vector<PathResult>&, Engine = ENGINE_BRANCH, std::vector<unsigned long long>* = NULL); //Solve each query, optionally timing each in ns
+    uint threads() const { return workers.size(); }
+    void straighten(bool on) { for (uint w = 0; w < workers.size(); w++) { workers[w]->finder.straighten = on; } } //Pull found paths straight (see PathFinder)
+    void scan(bool on) { for (uint w = 0; w < workers.size(); w++) { workers[w]->finder.scan = on; } } //Scan for the closest branch (see PathFinder)
+    void bidirectional(bool on) { for (uint w = 0; w < workers.size(); w++) { workers[w]->finder.bidirectional = on; } } //Grow branches from both ends (see PathFinder)
+    void fallback(bool on) { for (uint w = 0; w < workers.size(); w++) { workers[w]->finder.fallback = on; } } //Find the exact path on a timeout (see PathFinder)
+    void cache(size_t bytes) { for (uint w = 0; w < workers.size(); w++) { workers[w]->finder.cache.capacity = bytes; } } //Cache each worker's paths (see PathFinder)
+    void boardChanged() { for (uint w = 0; w < workers.size(); w++) { workers[w]->finder.boardChanged(); } } //The board has changed between batches (see PathFinder)
+
+  private:
+    struct Worker
+    {
+        PathFinder finder;
+        std::thread thread;
+        std::mutex lock; //Guards lo and hi
+        uint lo; //The run of queries still to take, [lo, hi)
+        uint hi;
+        Worker(const BitGrid& board, uint branchMax) : finder(board, branchMax), lo(0), hi(0) {}
+    };
+
+    const BitGrid& board;
+    std::vector<Worker*> workers; //workers[0] is the calling thread
+    std::mutex poolLock; //Guards the batch, and the counts below
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint batch; //Count of batches begun; workers wake when it changes
+    uint running; //Workers yet to finish this batch
+    bool stopping;
+  //This batch
+    const std::vector<Query>* queries;
+    std::vector<PathResult>* results;
+    std::vector<unsigned long long>* timings;
+    Engine engine;
+
+    void loop(uint); //A worker thread: wait for a batch, work on it, repeat
+    void work(uint); //Take and solve queries until there are none left anywhere
+    bool take(uint, uint&);
+    bool steal(uint);
+    BatchSolver(const BatchSolver&);
+    BatchSolver& operator=(const BatchSolver&);
+};
+
+BatchSolver::BatchSolver(const BitGrid& Board, uint threads, uint branchMax) : board(Board), batch(0), running(0), stopping(false)
+{
+    if (!threads) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    for (uint w = 0; w < threads; w++) { workers.push_back(new Worker(board, branchMax)); }
+    for (uint w = 1; w < threads; w++) { workers[w]->thread = std::thread(&BatchSolver::loop, this, w); }
+}
+
+BatchSolver::~BatchSolver()
+{
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (uint w = 1; w < workers.size(); w++) { workers[w]->thread.join(); }
+    for (uint w = 0; w < workers.size(); w++) { delete workers[w]; }
+}
+
+void BatchSolver::solve(const std::vector<Query>& Queries, std::vector<PathResult>& Results, Engine Eng, std::vector<unsigned long long>* Timings)
+{
+    Results.resize(Queries.size());
+    if (Timings) { Timings->resize(Queries.size()); }
+    if (Queries.empty()) { return; }
+  //Split the queries into a run per worker
+    uint n = workers.size(), size = Queries.size();
+    for (uint w = 0; w < n; w++)
+    {
+        workers[w]->lo = (uint64_t)size * w / n;
+        workers[w]->hi = (uint64_t)size * (w + 1) / n;
+    }
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        queries = &Queries;
+        results = &Results;
+        timings = Timings;
+        engine = Eng;
+        running = n - 1;
+        batch++;
+    }
+    wake.notify_all();
+  //Work alongside the pool, then wait for it
+    work(0);
+    std::unique_lock<std::mutex> guard(poolLock);
+    while (running) { done.wait(guard); }
+}
+
+void BatchSolver::loop(uint w)
+{
+    uint seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(poolLock);
+            while (batch == seen && !stopping) { wake.wait(guard); }
+            if (stopping) { return; }
+            seen = batch;
+        }
+        work(w);
+        {
+            std::lock_guard<std::mutex> guard(poolLock);
+            running--;
+        }
+        done.notify_one();
+    }
+}
+
+void BatchSolver::work(uint w)
+{
+    PathFinder& finder = workers[w]->finder;
+    uint q;
+    while (take(w, q) || (steal(w) && take(w, q)))
+    {
+        const Query& query = (*queries)[q];
+        PathResult& res = (*results)[q];
+        std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+        if (query.start.y < board.h && query.start.x < board.w && query.find.y < board.h && query.find.x < board.w)
+        {
+            res = finder.findPath(query.start, query.find, engine);
+        } else {
+            res = PathResult(); //Out of bounds: not found
+        }
+        if (timings) { (*timings)[q] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - began).count(); }
+    }
+}
+
+bool BatchSolver::take(uint w, uint& q) //Take the next query from the front of our own run
+{
+    Worker& me = *workers[w];
+    std::lock_guard<std::mutex> guard(me.lock);
+    if (me.lo == me.hi) { return false; }
+    q = me.lo++;
+    return true;
+}
+
+bool BatchSolver::steal(uint w) //Move the back half of the fullest other run to our own, returning false if every run is empty
+{
+    while (true)
+    {
+        uint victim = w, most = 0;
+        for (uint v = 0; v < workers.size(); v++)
+        {
+            if (v == w) { continue; }
+            std::lock_guard<std::mutex> guard(workers[v]->lock);
+            if (workers[v]->hi - workers[v]->lo > most) { victim = v; most = workers[v]->hi - workers[v]->lo; }
+        }
+        if (victim == w) { return false; }
+        Worker& them = *workers[victim];
+        uint lo, hi;
+        {
+            std::lock_guard<std::mutex> guard(them.lock);
+            if (them.lo == them.hi) { continue; } //Emptied since we looked: pick again
+            hi = them.hi;
+            them.hi -= (them.hi - them.lo + 1) / 2;
+            lo = them.hi;
+        }
+        Worker& me = *workers[w];
+        std::lock_guard<std::mutex> guard(me.lock);
+        me.lo = lo;
+        me.hi = hi;
+        return true;
+    }
+}
+
+#endif
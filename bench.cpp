@@ -0,0 +1,455 @@
+/*PatFind benchmark
+Runs the solver over fixed-seed scenario sets, one per randBoard() mode, and over a loaded map, writing a CSV line per query:
+    set,board,query,starty,startx,findy,findx,found,ns,branches,steps,len,optimal
+len and optimal both count the cells from the start to next to the find (optimal is -1 if the find cannot be reached)
+For the 8-connected engines (astar8, jps), optimal is the fewest cells over diagonal moves that cut no corner
+A summary of each set goes to stderr; with -t, it also gives the throughput of solving each board's queries as one batch on a pool of threads
+With -p, each query is solved with that many threads, sharing out rounds of branches (of at least -P) when enough are alive
+With -a, each board also gets a crowd of that many agents, moved a tick at a time until all have arrived, and the summary gives
+the time per tick and any collisions (which there should never be)
+With -x, every result (batched ones too) is checked against the breadth-first shortest path (found a cell at a time, not by the bfs engine's code), and any crowd collision counts:
+paths must start at the start, take only legal moves through open cells and end next to the find, the exact engines must
+match optimal, and every engine but the branch search (without -f) must find a path exactly when there is one.
+Each board then has cells toggled, on and off the paths, and the start moved along the path after each, with the query checked
+after every edit and move, so the engines' repairs are checked too (D* Lite repairs a run of them without planning afresh).
+Failures go to stderr, and the exit status is 1 if there were any; check.sh runs this over fixed boards for every engine
+*/
+
+#include <iostream> //For output
+#include <vector> //For queries and timings
+#include <string> //For set names
+#include <chrono> //For timing
+#include <algorithm> //For sorting timings
+#include <unordered_map> //For checking crowds
+#include <queue> //For checking 8-connected paths
+#include <cmath> //For M_SQRT2
+#include <unistd.h> //For argument parsing: getopt
+#include "pathFinder.h" //For the path finding engine
+#include "batch.h" //For solving queries on a pool of threads
+#include "parallel.h" //For solving one query on several threads
+#include "agents.h" //For moving crowds of agents
+#include "mapFile.h" //For loading boards from map files
+#include "randBoard.h" //For generating random boards
+
+using namespace std;
+
+uint boards = 10; //Boards per set
+uint queries = 10; //Queries per board
+uint benchW = 140;
+uint benchH = 40;
+uint seed = 1;
+Engine engine = ENGINE_BRANCH;
+uint threads = 0; //Pool size for batched throughput, or 0 to skip it
+uint roundThreads = 0; //Threads to solve each query on in rounds, or 0 to solve it on one
+uint roundWidth = 0; //Most branches in a shared round (0 for ROUNDMIN per thread)
+size_t cacheBytes = 0; //Memory for each finder's path cache, or 0 for none
+uint crowdSize = 0; //Agents per board, or 0 to skip crowds
+uint crowdWindow = WINDOW;
+bool check = false; //Check every result against the shortest path, with -x
+const uint EDITRUN = 4; //Edits, and start moves, checked per query before starting it afresh
+uint failures = 0;
+
+BitGrid board(benchH, benchW);
+BitGrid seen(benchH, benchW);
+WaveFront wave(board); //For the true shortest 4-connected paths
+PathFinder finder(board);
+ParallelFinder* par = NULL; //With -p
+
+void boardChanged() //Have every finder drop what it knew of the last board
+{
+    finder.boardChanged();
+    if (par) { par->finder.boardChanged(); }
+}
+
+int shortestPath(Coord start, Coord find) //Breadth-first search for the true shortest path, in cells from the start to next to the find, or -1
+{
+    bool diagonal = engine == ENGINE_ASTAR8 || engine == ENGINE_JPS;
+    if (!diagonal && !check) { return wave.distance(start, find); } //64 cells at a time; checks search a cell at a time, sharing no code with the bfs engine
+    if (seen.h != board.h || seen.w != board.w) { seen.resize(board.h, board.w); }
+    seen.clear();
+    vector<Coord> layer(1, start), next;
+    seen.set(start.y, start.x);
+    for (uint d = 0; !layer.empty(); d++)
+    {
+        next.clear();
+        for (uint c = 0; c < layer.size(); c++)
+        {
+            uint y = layer[c].y, x = layer[c].x;
+            if (adjacentTo(y, x, find.y, find.x)) { return d + 1; }
+            for (uint d = 0; d < (diagonal ? 8u : 4u); d++)
+            {
+                Coord n = {y + dirY[d], x + dirX[d]};
+                if (n.y >= board.h || n.x >= board.w || board.get(n.y, n.x) || seen.get(n.y, n.x)) { continue; }
+                if (d >= 4 && (board.get(n.y, x) || board.get(y, n.x))) { continue; } //Never cut a corner
+                seen.set(n.y, n.x);
+                next.push_back(n);
+            }
+        }
+        layer.swap(next);
+    }
+    return -1;
+}
+
+double shortestCost(Coord start, Coord find) //Dijkstra over 8-connected moves, a diagonal costing sqrt(2), for the least cost of a path; or -1
+{
+    vector<double> cost(board.h * board.w, -1);
+    priority_queue<pair<double, uint>, vector<pair<double, uint> >, greater<pair<double, uint> > > open;
+    cost[start.y * board.w + start.x] = 0;
+    open.push(make_pair(0.0, start.y * board.w + start.x));
+    while (!open.empty())
+    {
+        double c = open.top().first;
+        uint y = open.top().second / board.w, x = open.top().second % board.w;
+        open.pop();
+        if (c > cost[y * board.w + x]) { continue; } //Lowered since
+        if (adjacentTo(y, x, find.y, find.x)) { return c; }
+        for (uint d = 0; d < 8; d++)
+        {
+            uint ny = y + dirY[d], nx = x + dirX[d];
+            if (ny >= board.h || nx >= board.w || board.get(ny, nx)) { continue; }
+            if (d >= 4 && (board.get(ny, x) || board.get(y, nx))) { continue; } //Never cut a corner
+            double n = c + (d >= 4 ? M_SQRT2 : 1);
+            double& was = cost[ny * board.w + nx];
+            if (was >= 0 && was <= n) { continue; }
+            was = n;
+            open.push(make_pair(n, ny * board.w + nx));
+        }
+    }
+    return -1;
+}
+
+string checkPath(Coord start, Coord find, const PathResult& res, int optimal) //What is wrong with a result, or "" if nothing
+{
+    bool exact = engine != ENGINE_BRANCH && engine != ENGINE_HPA;
+    bool complete = engine != ENGINE_BRANCH || finder.fallback; //Reports no path only when there is none
+    bool diagonal = engine == ENGINE_ASTAR8 || engine == ENGINE_JPS;
+    if (!res.found) { return complete && optimal >= 0 ? "no path found, but there is one" : ""; }
+    if (optimal < 0) { return "found a path, but there is none"; }
+    const vector<Coord>& p = res.path;
+    if (p.empty() || p[0].y != start.y || p[0].x != start.x) { return "the path does not begin at the start"; }
+    double cost = 0;
+    for (uint i = 1; i < p.size(); i++)
+    {
+        uint dy = max(p[i].y, p[i - 1].y) - min(p[i].y, p[i - 1].y), dx = max(p[i].x, p[i - 1].x) - min(p[i].x, p[i - 1].x);
+        if (p[i].y >= board.h || p[i].x >= board.w || board.get(p[i].y, p[i].x)) { return "step " + to_string(i) + " is not an open cell"; }
+        if (dy > 1 || dx > 1 || dy + dx == 0 || (!diagonal && dy + dx > 1)) { return "step " + to_string(i) + " is not a move"; }
+        if (dy + dx == 2 && (board.get(p[i].y, p[i - 1].x) || board.get(p[i - 1].y, p[i].x))) { return "step " + to_string(i) + " cuts a corner"; }
+        cost += dy + dx == 2 ? M_SQRT2 : 1;
+    }
+    if (!adjacentTo(p.back().y, p.back().x, find.y, find.x)) { return "the path does not end next to the find"; }
+    if ((int)p.size() < optimal) { return "the path is shorter than optimal"; }
+    if (exact && !diagonal && (int)p.size() != optimal) { return "the path is longer than optimal"; }
+    if (diagonal && cost > shortestCost(start, find) + 1e-6) { return "the path costs " + to_string(cost) + ", more than the cheapest"; } //Optimal by cost, not by cells
+    return "";
+}
+
+void checkResult(const string& set, uint b, uint q, Coord start, Coord find, const PathResult& res, int optimal, const char* how)
+{
+    string wrong = checkPath(start, find, res, optimal);
+    if (wrong.empty()) { return; }
+    failures++;
+    cerr << "CHECK FAILED " << set << " board " << b << " query " << q << how << ": (" << start.y << "," << start.x << ") to ("
+         << find.y << "," << find.x << "), " << wrong << " (len " << res.path.size() << ", optimal " << optimal << ")" << endl;
+}
+
+struct Summary
+{
+    vector<unsigned long long> ns;
+    uint timeouts;
+    uint unreachable;
+    double lenRatio; //Sum over found, reachable queries of len / optimal
+    uint ratioCount;
+    unsigned long long batchNs; //Time spent solving batches on the pool
+    uint batched; //Queries in them
+  //Crowds
+    unsigned long long crowdNs;
+    uint ticks;
+    uint agents;
+    uint arrived;
+    uint collisions; //Two agents in one cell, or swapping cells, at a tick
+    uint64_t replans;
+    uint64_t blocked; //Of them, plans that found no way on
+};
+
+void runBatch(const string& set, uint b, const vector<Query>& batch, Summary& sum) //Solve a board's queries again, as one batch on the pool
+{
+    if (!threads || batch.empty()) { return; }
+    static BatchSolver pool(board, threads, finder.branchMax);
+    pool.straighten(finder.straighten);
+    pool.scan(finder.scan);
+    pool.bidirectional(finder.bidirectional);
+    pool.fallback(finder.fallback);
+    pool.cache(cacheBytes);
+    pool.boardChanged();
+    vector<PathResult> results;
+    chrono::steady_clock::time_point began = chrono::steady_clock::now();
+    pool.solve(batch, results, engine);
+    sum.batchNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - began).count();
+    sum.batched += batch.size();
+    if (!check) { return; }
+    for (uint q = 0; q < batch.size(); q++) { checkResult(set, b, q, batch[q].start, batch[q].find, results[q], shortestPath(batch[q].start, batch[q].find), " (batched)"); }
+}
+
+void runCrowd(const string& set, uint b, Summary& sum) //Move a crowd of agents across the board, from open cells to open cells, until all arrive or time runs out
+{
+    if (!crowdSize) { return; }
+    Crowd crowd(board, crowdWindow);
+    BitGrid taken(board.h, board.w), goals(board.h, board.w);
+    for (uint a = 0, tries = 0; a < crowdSize && tries < crowdSize * 100; tries++)
+    {
+        Coord start, find;
+        randEnds(board, start, find);
+        if (board.get(start.y, start.x) || board.get(find.y, find.x) || taken.get(start.y, start.x) || goals.get(find.y, find.x)) { continue; }
+        taken.set(start.y, start.x);
+        goals.set(find.y, find.x);
+        crowd.add(start, find);
+        a++;
+    }
+    uint n = crowd.agents.size(), limit = 4 * (board.h + board.w), t = 0, done = 0;
+    vector<Coord> was(n);
+    unordered_map<uint, uint> wasAt; //Agent at each cell a tick ago
+    uint collisions = sum.collisions; //Before this crowd
+    chrono::steady_clock::time_point began = chrono::steady_clock::now();
+    for (; t < limit && done < n; t++)
+    {
+        for (uint a = 0; a < n; a++) { was[a] = crowd.agents[a].pos; }
+        crowd.step();
+      //Check no two agents meet
+        taken.clear();
+        for (uint a = 0; a < n; a++)
+        {
+            Coord p = crowd.agents[a].pos;
+            if (taken.get(p.y, p.x)) { sum.collisions++; }
+            taken.set(p.y, p.x);
+        }
+        wasAt.clear();
+        for (uint a = 0; a < n; a++) { wasAt[was[a].y * board.w + was[a].x] = a; }
+        for (uint a = 0; a < n; a++)
+        {
+            Coord p = crowd.agents[a].pos;
+            if (p.y == was[a].y && p.x == was[a].x) { continue; }
+            unordered_map<uint, uint>::iterator other = wasAt.find(p.y * board.w + p.x);
+            if (other != wasAt.end() && crowd.agents[other->second].pos.y == was[a].y && crowd.agents[other->second].pos.x == was[a].x) { sum.collisions++; }
+        }
+        done = 0;
+        for (uint a = 0; a < n; a++) { done += crowd.arrived(a); }
+    }
+    sum.crowdNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - began).count();
+    sum.ticks += t;
+    sum.agents += n;
+    sum.arrived += done;
+    sum.replans += crowd.replans;
+    sum.blocked += crowd.blocked;
+    if (check && sum.collisions != collisions)
+    {
+        failures++;
+        cerr << "CHECK FAILED " << set << " board " << b << ": " << sum.collisions - collisions << " crowd collisions" << endl;
+    }
+}
+
+PathResult solve(Coord start, Coord find) //One query, on the threads in rounds with -p
+{
+    return par && engine == ENGINE_BRANCH ? par->findPath(start, find) : finder.findPath(start, find, engine);
+}
+
+void runEdits(const string& set, uint b, const vector<Query>& batch) //With -x: toggle cells and move starts, passing each on, and check the query after every one
+{
+    if (!check || batch.empty()) { return; }
+    uint editSeed = seed * 2654435761u + b; //Apart from g_seed, so checking leaves the boards and queries as they were
+    Coord start, find;
+    PathResult res;
+    for (uint e = 0; e < queries; e++)
+    {
+        if (e % EDITRUN == 0) //A fresh query, then a run of edits and start moves, each repaired from the last (by D* Lite)
+        {
+            start = batch[e / EDITRUN % batch.size()].start;
+            find = batch[e / EDITRUN % batch.size()].find;
+            res = solve(start, find);
+        }
+      //Toggle a cell on the path half the time, as those edits are the ones the engines must repair, else anywhere
+        editSeed = 214013 * editSeed + 2531011;
+        uint r = editSeed >> 8;
+        uint y = r % board.h, x = r / board.h % board.w;
+        if (res.found && r & 1) { y = res.path[r % res.path.size()].y; x = res.path[r % res.path.size()].x; }
+        board.put(y, x, !board.get(y, x));
+        if (par) { par->finder.cellChanged(y, x); }
+        if (finder.cellChanged(y, x)) { res = finder.result; } //Repaired in place by D* Lite
+        else { res = solve(start, find); }
+        checkResult(set, b, e, start, find, res, shortestPath(start, find), " (after an edit)");
+      //Move the start 1 to 3 cells along the path, as an agent following it would
+        if (!res.found || res.path.size() < 2) { continue; }
+        start = res.path[1 + r / 2 % min<size_t>(3, res.path.size() - 1)];
+        if (finder.startMoved(start)) { res = finder.result; }
+        else { res = solve(start, find); }
+        checkResult(set, b, e, start, find, res, shortestPath(start, find), " (after the start moved)");
+    }
+}
+
+void runQuery(const string& set, uint b, uint q, Coord start, Coord find, Summary& sum)
+{
+    chrono::steady_clock::time_point began = chrono::steady_clock::now();
+    PathResult res;
+    if (par && engine == ENGINE_BRANCH)
+    {
+        res = par->findPath(start, find);
+    } else {
+        res = finder.findPath(start, find, engine);
+    }
+    unsigned long long tookNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - began).count();
+    int optimal = shortestPath(start, find);
+    cout << set << "," << b << "," << q << "," << start.y << "," << start.x << "," << find.y << "," << find.x << ","
+         << res.found << "," << tookNs << "," << res.branches << "," << res.steps << "," << res.path.size() << "," << optimal << "\n";
+    sum.ns.push_back(tookNs);
+    if (!res.found) { sum.timeouts++; }
+    if (optimal < 0) { sum.unreachable++; }
+    if (res.found && optimal > 0) { sum.lenRatio += (double)res.path.size() / optimal; sum.ratioCount++; }
+    if (check) { checkResult(set, b, q, start, find, res, optimal, ""); }
+}
+
+void summarise(const string& set, Summary& sum)
+{
+    if (sum.ns.empty()) { return; }
+    sort(sum.ns.begin(), sum.ns.end());
+    unsigned long long total = 0;
+    for (uint i = 0; i < sum.ns.size(); i++) { total += sum.ns[i]; }
+    cerr << set << ": " << sum.ns.size() << " queries, " << sum.timeouts << " timeouts (" << sum.unreachable << " unreachable), "
+         << "mean " << total / sum.ns.size() << "ns, p50 " << sum.ns[sum.ns.size() / 2] << "ns, p99 " << sum.ns[sum.ns.size() * 99 / 100] << "ns, "
+         << "len/optimal " << (sum.ratioCount ? sum.lenRatio / sum.ratioCount : 0) << endl;
+    if (cacheBytes)
+    {
+        cerr << set << ": cache " << finder.cache.hits << " hits, " << finder.cache.misses << " misses, " << finder.cache.size() << " paths in " << finder.cache.bytes / 1024 << "KB" << endl;
+        finder.cache.hits = finder.cache.misses = 0;
+    }
+    if (sum.batched)
+    {
+        unsigned long long total = 0;
+        for (uint i = 0; i < sum.ns.size(); i++) { total += sum.ns[i]; }
+        cerr << set << ": " << (unsigned long long)(sum.batched * 1e9 / sum.batchNs) << " queries/s batched on " << threads << " threads, against "
+             << (unsigned long long)(sum.ns.size() * 1e9 / total) << " queries/s one at a time" << endl;
+    }
+    if (sum.agents)
+    {
+        cerr << set << ": crowds of " << crowdSize << ", " << sum.arrived << "/" << sum.agents << " agents arrived in " << sum.ticks << " ticks, "
+             << sum.crowdNs / max(1u, sum.ticks) << "ns per tick, " << sum.replans << " replans (" << sum.blocked << " stuck), " << sum.collisions << " collisions" << endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    string modes = "rlsmc";
+    bool modesGiven = false;
+    const char* mapPath = NULL;
+    const char* scenPath = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:q:S:W:H:n:r:m:s:e:t:p:P:c:a:A:dflvx")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': boards = atoi(optarg); break;
+            case 'q': queries = atoi(optarg); break;
+            case 'S': seed = atoi(optarg); break;
+            case 'W': benchW = atoi(optarg); break;
+            case 'H': benchH = atoi(optarg); break;
+            case 'n': finder.branchMax = atoi(optarg); break;
+            case 'r': modes = optarg; modesGiven = true; break;
+            case 'm': mapPath = optarg; break;
+            case 's': scenPath = optarg; break;
+            case 'l': finder.straighten = true; break;
+            case 'd': finder.bidirectional = true; break;
+            case 'f': finder.fallback = true; break;
+            case 'v': finder.scan = true; break;
+            case 'x': check = true; break;
+            case 't': threads = max(1, atoi(optarg)); break;
+            case 'p': roundThreads = max(1, atoi(optarg)); break;
+            case 'P': roundWidth = atoi(optarg); break;
+            case 'a': crowdSize = atoi(optarg); break;
+            case 'A': crowdWindow = max(1, atoi(optarg)); break;
+            case 'c': cacheBytes = (size_t)max(0, atoi(optarg)) * 1024; finder.cache.capacity = cacheBytes; break;
+            case 'e':
+                if (!engineByName(optarg, engine)) { cerr << "Unknown engine " << optarg << " (branch, astar, astar8, jps, dlite, hpa, field or bfs)" << endl; return 1; }
+                break;
+            default:
+                cerr << "Usage: bench.elf [-b boards] [-q queries] [-S seed] [-W width] [-H height] [-n branches] [-r modes] [-e engine] [-l] [-v] [-d] [-f] [-t threads] [-p threads [-P width]] [-c KB] [-a agents [-A window]] [-m map [-s scen]] [-x]" << endl;
+                return 1;
+        }
+    }
+    if (mapPath && !modesGiven) { modes = ""; }
+    if (roundThreads)
+    {
+        par = new ParallelFinder(board, roundThreads, roundWidth, finder.branchMax);
+        par->finder.straighten = finder.straighten;
+        par->finder.scan = finder.scan;
+        par->finder.fallback = finder.fallback;
+    }
+    cout << "set,board,query,starty,startx,findy,findx,found,ns,branches,steps,len,optimal\n";
+  //A set per randBoard() mode, each from its own seed so sets do not depend on which others are run
+    for (uint m = 0; m < modes.length(); m++)
+    {
+        string set(1, modes[m]);
+        Summary sum = Summary();
+        g_seed = seed * 2654435761u + modes[m];
+        for (uint b = 0; b < boards; b++)
+        {
+            board.resize(benchH, benchW);
+            randBoard(board, modes[m]);
+            boardChanged();
+            vector<Query> batch;
+            for (uint q = 0; q < queries; q++)
+            {
+                Coord start, find;
+                randEnds(board, start, find);
+                runQuery(set, b, q, start, find, sum);
+                batch.push_back({start, find});
+            }
+            runBatch(set, b, batch, sum);
+            runCrowd(set, b, sum);
+            runEdits(set, b, batch);
+        }
+        summarise(set, sum);
+    }
+  //The loaded map, with its scenarios or random queries
+    if (mapPath)
+    {
+        string set = mapPath;
+        Summary sum = Summary();
+        if (!loadMap(mapPath, board)) { cerr << "Could not load map " << mapPath << endl; return 1; }
+        boardChanged();
+        if (scenPath)
+        {
+            vector<Scenario> scens;
+            if (!loadScenarios(scenPath, scens)) { cerr << "Could not load scenarios " << scenPath << endl; return 1; }
+            vector<Query> batch;
+            for (uint q = 0; q < scens.size(); q++)
+            {
+                Coord s = scens[q].start, f = scens[q].find;
+                if (s.y >= board.h || s.x >= board.w || f.y >= board.h || f.x >= board.w) //Off the map: skip it
+                {
+                    cerr << "Skipping scenario " << q << ": (" << s.x << "," << s.y << ") to (" << f.x << "," << f.y << ") is outside the " << board.w << "x" << board.h << " map" << endl;
+                    continue;
+                }
+                runQuery(set, 0, q, scens[q].start, scens[q].find, sum);
+                batch.push_back({scens[q].start, scens[q].find});
+            }
+            runBatch(set, 0, batch, sum);
+            runCrowd(set, 0, sum);
+            runEdits(set, 0, batch);
+        } else {
+            g_seed = seed;
+            vector<Query> batch;
+            for (uint q = 0; q < boards * queries; q++)
+            {
+                Coord start, find;
+                randEnds(board, start, find);
+                runQuery(set, 0, q, start, find, sum);
+                batch.push_back({start, find});
+            }
+            runBatch(set, 0, batch, sum);
+            runCrowd(set, 0, sum);
+            runEdits(set, 0, batch);
+        }
+        summarise(set, sum);
+    }
+    delete par;
+    if (check) { cerr << failures << " check failures" << endl; }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+//===================================
+//Finding the closest alive branch to the find, in one pass over contiguous branch positions
+//  - Positions are packed as x << 16 | y, each under 32768, so the two differences from the find fit 16-bit lanes,
+//    and multiply-adding them with themselves gives the squared distance in a 32-bit lane (SSE2 pmaddwd)
+//  - Dead branches carry a mask of 0x7FFFFFFF, which is ORed in; no squared distance reaches it
+//  - AVX2 (build with -mavx2) does 8 branches at a time, SSE2 4, and anything else one
+//Ties go to the lowest index, as in the frontier heap
+//===================================
+#ifndef BRANCHSCAN_H
+#define BRANCHSCAN_H
+
+#include <stdint.h> //For uint32_t
+#include "grid.h" //For uint
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h> //For SIMD intrinsics
+#endif
+
+const uint SCANMAX = 32767; //Largest coordinate the scan can take
+const uint32_t SCANDEAD = 0x7FFFFFFF; //Dead mask, above any squared distance
+
+inline uint32_t packPos(uint y, uint x) { return x << 16 | y; }
+
+inline uint scanClosest(const uint32_t* pos, const uint32_t* dead, uint n, uint32_t goal) //Index of the closest alive branch of n, or n if none are alive
+{
+    uint i = 0;
+    uint32_t bestD = SCANDEAD;
+    uint best = n;
+#if defined(__AVX2__)
+    if (n >= 8)
+    {
+        __m256i g = _mm256_set1_epi32(goal), d8 = _mm256_set1_epi32(SCANDEAD), i8 = _mm256_set1_epi32(n);
+        __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), step = _mm256_set1_epi32(8);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i diff = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(pos + i)), g);
+            __m256i sq = _mm256_or_si256(_mm256_madd_epi16(diff, diff), _mm256_loadu_si256((const __m256i*)(dead + i)));
+            __m256i lt = _mm256_cmpgt_epi32(d8, sq);
+            d8 = _mm256_blendv_epi8(d8, sq, lt);
+            i8 = _mm256_blendv_epi8(i8, idx, lt);
+            idx = _mm256_add_epi32(idx, step);
+        }
+        uint32_t ds[8], is[8];
+        _mm256_storeu_si256((__m256i*)ds, d8);
+        _mm256_storeu_si256((__m256i*)is, i8);
+        for (uint l = 0; l < 8; l++) { if (ds[l] < bestD || (ds[l] == bestD && is[l] < best)) { bestD = ds[l]; best = is[l]; } }
+    }
+#elif defined(__SSE2__)
+    if (n >= 4)
+    {
+        __m128i g = _mm_set1_epi32(goal), d4 = _mm_set1_epi32(SCANDEAD), i4 = _mm_set1_epi32(n);
+        __m128i idx = _mm_setr_epi32(0, 1, 2, 3), step = _mm_set1_epi32(4);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i diff = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(pos + i)), g);
+            __m128i sq = _mm_or_si128(_mm_madd_epi16(diff, diff), _mm_loadu_si128((const __m128i*)(dead + i)));
+            __m128i lt = _mm_cmplt_epi32(sq, d4); //SSE2 has no blend: select by mask
+            d4 = _mm_or_si128(_mm_and_si128(lt, sq), _mm_andnot_si128(lt, d4));
+            i4 = _mm_or_si128(_mm_and_si128(lt, idx), _mm_andnot_si128(lt, i4));
+            idx = _mm_add_epi32(idx, step);
+        }
+        uint32_t ds[4], is[4];
+        _mm_storeu_si128((__m128i*)ds, d4);
+        _mm_storeu_si128((__m128i*)is, i4);
+        for (uint l = 0; l < 4; l++) { if (ds[l] < bestD || (ds[l] == bestD && is[l] < best)) { bestD = ds[l]; best = is[l]; } }
+    }
+#endif
+    for (; i < n; i++) //What is left, or everything without SIMD
+    {
+        int dy = (int)(pos[i] & 0xFFFF) - (int)(goal & 0xFFFF), dx = (int)(pos[i] >> 16) - (int)(goal >> 16);
+        uint32_t d = (uint32_t)(dy * dy + dx * dx) | dead[i];
+        if (d < bestD) { bestD = d; best = i; }
+    }
+    return bestD == SCANDEAD ? n : best;
+}
+
+#endif
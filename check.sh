@@ -0,0 +1,19 @@
+#Checked regression run: bench.elf -x over fixed-seed boards, for every engine and option, failing on the first run with a wrong result
+#Each run checks every path against the true shortest path, after edits to the board too; the failures are listed on stderr
+fail=0
+run() { echo "bench.elf -x $*"; ./bench.elf -x "$@" > /dev/null 2> check.log || { grep CHECK check.log; fail=1; }; }
+for engine in branch astar astar8 jps dlite hpa field bfs; do
+    run -b 4 -q 30 -e $engine
+    run -b 2 -q 30 -W 200 -H 200 -e $engine
+    run -b 4 -q 30 -e $engine -c 256 -t 4
+done
+run -b 4 -q 30 -f
+run -b 4 -q 30 -l -d
+run -b 4 -q 30 -v
+run -b 4 -q 30 -p 4
+run -b 4 -q 30 -p 4 -P 1 -l
+run -b 2 -q 10 -W 600 -H 600 -n 20000 -r s -p 2
+run -b 4 -q 10 -a 40
+run -b 2 -q 10 -a 20 -A 4
+rm -f check.log
+exit $fail
@@ -1,2 +1,3 @@
 #g++ patFind.cpp -o patFind.elf --std=c++11 -static-libstdc++
-g++ patFind.cpp -o patFind.elf --std=c++11 -g
+g++ patFind.cpp -o patFind.elf --std=c++11 -O2 -g -pthread
+g++ bench.cpp -o bench.elf --std=c++11 -O2 -g -pthread
@@ -0,0 +1,268 @@
+//===================================
+//Connected components of the open cells of the board, so walled-off queries are turned away before any search
+//  - Each open cell has a label, and labels are joined in a union-find forest: cells are connected when their labels share a root
+//  - Labels are held per 64x64 tile, as the board is: a tile numbers its own pieces in 16 bits per cell, and keeps each
+//    piece's label. A tile with no blocks is one piece and holds no numbers per cell at all, so open country costs next to nothing
+//  - Clearing a cell joins the labels around it
+//  - Blocking a cell may cut its component apart: a breadth-first search grows from each open cell around it, in turns,
+//    and any search that runs out of cells before meeting the others has its cells given a new label.
+//    So the work is bounded by the smaller pieces, not the component
+//Moves are 4-connected, and the start may be left from a block, as in every engine
+//===================================
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <vector> //For labels and the searches
+#include <stdint.h> //For uint16_t
+#include "grid.h" //For BitGrid and TiledGrid
+#include "aStar.h" //For directions
+
+const uint TILEPIECES = 0xFFFF; //Most pieces a tile may number; past that, the labels are built afresh
+
+class Components
+{
+  public:
+    const BitGrid& board;
+    TiledGrid<uint16_t> piece; //Per cell, its piece of its tile (tiles never written to are all piece 0)
+    std::vector<std::vector<uint> > pieces; //Per tile, the label of each of its pieces
+    std::vector<uint> parent; //Of each label, in the union-find forest (label 0 is unused)
+    bool built;
+
+    Components(const BitGrid&);
+    void build(); //Label the whole board
+    void cellChanged(uint, uint); //A cell of the board has been blocked or cleared
+    bool connected(Coord, Coord); //Could any path lead from the start to the find (or next to it)? Builds first if need be
+    uint root(uint);
+    uint label(uint y, uint x) const { return board.get(y, x) ? 0 : pieces[tileOf(y, x)][piece.get(y, x)]; } //0 for a block
+
+  private:
+  //Numbering a tile's pieces
+    std::vector<uint64_t> runs; //Runs of open cells, row by row, as bits of the row
+    std::vector<uint> runUp; //Union-find forest of the runs
+    std::vector<uint> runSize; //Cells in each root's piece
+    std::vector<uint> runPiece; //Each root's number in the tile
+    uint rowFirst[TILE + 1]; //Index of each row's first run
+  //The searches of a split, one from each open cell around the blocked one
+    TiledGrid<uint> seen; //Split each cell was last reached in, times 4, plus the search that reached it
+    std::vector<uint> cells[4]; //Each search's cells (y * w + x), in the order reached
+    uint heads[4];
+    uint joined[4]; //Searches that meet are joined, and go on as one
+    uint gen;
+
+    uint tileOf(uint y, uint x) const { return (y >> TILEBITS) * piece.tilesW + (x >> TILEBITS); }
+    uint newLabel() { parent.push_back(parent.size()); return parent.size() - 1; }
+    void join(uint a, uint b) { a = root(a); b = root(b); if (a != b) { parent[std::max(a, b)] = std::min(a, b); } }
+    void joinFacing(uint y, uint x, uint y2, uint x2, uint& a, uint& b) //Join two cells' labels, unless they are the last pair joined
+    {
+        uint la = label(y, x), lb = label(y2, x2);
+        if (!la || !lb || (la == a && lb == b)) { return; }
+        join(la, lb);
+        a = la;
+        b = lb;
+    }
+    void setLabel(uint, uint, uint); //Give an open cell a label, as a piece of its tile
+    void numberTile(uint); //Number the pieces of a tile with blocks in it
+    uint runRoot(uint a) { while (runUp[a] != a) { a = runUp[a] = runUp[runUp[a]]; } return a; }
+    void joinRuns(uint a, uint b) { a = runRoot(a); b = runRoot(b); if (a != b) { runUp[std::max(a, b)] = std::min(a, b); } }
+    uint search(uint s) { while (joined[s] != s) { s = joined[s]; } return s; }
+    void split(uint, uint);
+};
+
+Components::Components(const BitGrid& Board) : board(Board), built(false), gen(0) {}
+
+uint Components::root(uint l)
+{
+    while (parent[l] != l)
+    {
+        parent[l] = parent[parent[l]]; //Halve the path as we go
+        l = parent[l];
+    }
+    return l;
+}
+
+void Components::setLabel(uint y, uint x, uint l)
+{
+    std::vector<uint>& p = pieces[tileOf(y, x)];
+    uint n = p.size();
+    while (n && p[n - 1] != l) { n--; } //Newest first, as a split gives many cells of a tile the label it has just added
+    if (n) { n--; }
+    else if (p.size() == TILEPIECES) { built = false; return; }
+    else { n = p.size(); p.push_back(l); }
+    if (n || piece.get(y, x)) { piece.at(y, x) = n; } //Piece 0 needs no tile
+}
+
+void Components::numberTile(uint t) //A row at a time, joining each run of open cells to those it touches in the row above
+{
+    uint y0 = t / piece.tilesW << TILEBITS, wx = t % piece.tilesW, x0 = wx << TILEBITS;
+    uint rows = std::min(TILE, board.h - y0);
+    uint64_t inside = board.w - x0 >= TILE ? ~(uint64_t)0 : ((uint64_t)1 << (board.w - x0)) - 1;
+    runs.clear();
+    runUp.clear();
+    for (uint r = 0; r < rows; r++)
+    {
+        rowFirst[r] = runs.size();
+        for (uint64_t open = ~board.word(y0 + r, wx) & inside; open; )
+        {
+            uint64_t run = open & ~(open + (open & -open)); //The lowest run
+            open &= ~run;
+            runs.push_back(run);
+            runUp.push_back(runs.size() - 1);
+            for (uint a = r ? rowFirst[r - 1] : 0; a < rowFirst[r]; a++) { if (runs[a] & run) { joinRuns(a, runs.size() - 1); } }
+        }
+    }
+    rowFirst[rows] = runs.size();
+  //The biggest piece is piece 0, which needs nothing written per cell; the others are numbered after it
+    runSize.assign(runs.size(), 0);
+    uint biggest = 0;
+    for (uint a = 0; a < runs.size(); a++)
+    {
+        uint r = runRoot(a);
+        runSize[r] += __builtin_popcountll(runs[a]);
+        if (runSize[r] > runSize[biggest]) { biggest = r; }
+    }
+    runPiece.assign(runs.size(), TILEPIECES);
+    if (!runs.empty()) { runPiece[biggest] = 0; pieces[t].push_back(newLabel()); }
+    for (uint r = 0; r < rows; r++)
+    {
+        for (uint a = rowFirst[r]; a < rowFirst[r + 1]; a++)
+        {
+            uint root = runRoot(a);
+            if (runPiece[root] == TILEPIECES) { runPiece[root] = pieces[t].size(); pieces[t].push_back(newLabel()); }
+            uint16_t n = runPiece[root];
+            if (!n) { continue; }
+            for (uint64_t bits = runs[a]; bits; bits &= bits - 1) { piece.at(y0 + r, x0 + __builtin_ctzll(bits)) = n; }
+        }
+    }
+}
+
+void Components::build()
+{
+    piece.resize(board.h, board.w);
+    seen.resize(board.h, board.w);
+    pieces.assign(piece.tiles.size(), std::vector<uint>());
+    parent.assign(1, 0);
+    gen = 0;
+  //Number each tile's pieces: a tile with no blocks is a single piece
+    for (uint t = 0; t < pieces.size(); t++)
+    {
+        uint y0 = t / piece.tilesW << TILEBITS, wx = t % piece.tilesW;
+        bool blocks = false;
+        for (uint y = y0; y < std::min(y0 + TILE, board.h) && !blocks; y++) { blocks = board.word(y, wx); }
+        if (blocks) { numberTile(t); } else { pieces[t].push_back(newLabel()); }
+    }
+  //Join the pieces facing each other across the tiles' edges, skipping pairs just joined (as along an open edge, they all are)
+    for (uint x = TILE - 1; x + 1 < board.w; x += TILE)
+    {
+        uint a = 0, b = 0;
+        for (uint y = 0; y < board.h; y++) { joinFacing(y, x, y, x + 1, a, b); }
+    }
+    for (uint y = TILE - 1; y + 1 < board.h; y += TILE)
+    {
+        uint a = 0, b = 0;
+        for (uint x = 0; x < board.w; x++) { joinFacing(y, x, y + 1, x, a, b); }
+    }
+    built = true;
+}
+
+void Components::cellChanged(uint y, uint x)
+{
+    if (!built) { return; }
+    if (piece.h != board.h || piece.w != board.w) { built = false; return; } //Resized: build afresh at the next query
+    if (board.get(y, x)) { split(y, x); return; }
+  //Cleared: join everything around it
+    uint l = 0;
+    for (uint d = 0; d < 4; d++)
+    {
+        uint ny = y + dirY[d], nx = x + dirX[d];
+        if (ny >= board.h || nx >= board.w || board.get(ny, nx)) { continue; }
+        if (l) { join(l, label(ny, nx)); } else { l = label(ny, nx); }
+    }
+    setLabel(y, x, l ? l : newLabel());
+}
+
+void Components::split(uint y, uint x)
+{
+    if (!++gen || gen >> 30) { seen.clear(); gen = 1; }
+  //A search from each open cell around
+    uint k = 0;
+    for (uint d = 0; d < 4; d++)
+    {
+        uint ny = y + dirY[d], nx = x + dirX[d];
+        if (ny >= board.h || nx >= board.w || board.get(ny, nx)) { continue; }
+        cells[k].assign(1, ny * board.w + nx);
+        heads[k] = 0;
+        joined[k] = k;
+        seen.at(ny, nx) = gen << 2 | k;
+        k++;
+    }
+    if (k < 2) { return; } //Nothing to cut apart
+    bool done[4] = {false, false, false, false}; //Given a new label, or the last one left
+    while (true)
+    {
+      //Any search (with those it has met) that has run out of cells is a piece cut off
+        uint left = 0;
+        for (uint s = 0; s < k; s++)
+        {
+            if (search(s) != s || done[s]) { continue; }
+            bool out = true;
+            for (uint t = 0; t < k; t++) { if (search(t) == s && heads[t] < cells[t].size()) { out = false; } }
+            if (!out) { left++; continue; }
+            done[s] = true;
+            uint l = newLabel();
+            for (uint t = 0; t < k; t++)
+            {
+                if (search(t) != s) { continue; }
+                for (uint c = 0; c < cells[t].size(); c++) { setLabel(cells[t][c] / board.w, cells[t][c] % board.w, l); }
+            }
+        }
+        if (left <= 1) { return; } //The rest keeps the old label
+      //Take a step of each search in turn
+        for (uint s = 0; s < k; s++)
+        {
+            if (done[search(s)] || heads[s] == cells[s].size()) { continue; }
+            uint c = cells[s][heads[s]++], cy = c / board.w, cx = c % board.w;
+            for (uint d = 0; d < 4; d++)
+            {
+                uint ny = cy + dirY[d], nx = cx + dirX[d];
+                if (ny >= board.h || nx >= board.w || board.get(ny, nx)) { continue; }
+                uint& mark = seen.at(ny, nx);
+                if (mark >> 2 != gen)
+                {
+                    mark = gen << 2 | s;
+                    cells[s].push_back(ny * board.w + nx);
+                } else if (search(mark & 3) != search(s)) { //Met another search: the same piece
+                    joined[search(mark & 3)] = search(s);
+                }
+            }
+        }
+    }
+}
+
+bool Components::connected(Coord start, Coord find)
+{
+    if (!built || piece.h != board.h || piece.w != board.w) { build(); }
+    if (adjacentTo(start.y, start.x, find.y, find.x)) { return true; }
+  //The start's component, or those around it if it is a block
+    uint from[4], n = 0;
+    if (!board.get(start.y, start.x)) { from[n++] = root(label(start.y, start.x)); }
+    else
+    {
+        for (uint d = 0; d < 4; d++)
+        {
+            uint y = start.y + dirY[d], x = start.x + dirX[d];
+            if (y < board.h && x < board.w && !board.get(y, x)) { from[n++] = root(label(y, x)); }
+        }
+    }
+  //Any open cell at or next to the find in one of them?
+    const int around[5][2] = {{0, 0}, {-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (uint a = 0; a < 5; a++)
+    {
+        uint y = find.y + around[a][0], x = find.x + around[a][1];
+        if (y >= board.h || x >= board.w || board.get(y, x)) { continue; }
+        uint r = root(label(y, x));
+        for (uint f = 0; f < n; f++) { if (from[f] == r) { return true; } }
+    }
+    return false;
+}
+
+#endif
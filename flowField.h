@@ -0,0 +1,196 @@
+//===================================
+//A distance field out from one find, for many queries heading to the same place
+//  - A breadth-first search from the find gives every open cell its steps to the find (or next to it), in 16 bits
+//  - From any cell, the next step is to a neighbour one step closer, so a path costs only its length to read
+//  - When a cell is cleared, distances are lowered outward from it. When one is blocked, the cells whose every
+//    shortest way ran through it are found a layer at a time, and given new distances from the cells around them
+//Moves are 4-connected, and the start may be left from a block, as in every engine
+//Cells more than FIELDMAX steps away are treated as unreachable (and truncated is set)
+//===================================
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <vector> //For the field and its queues
+#include <algorithm> //For the lowering heap
+#include <stdint.h> //For uint16_t
+#include "grid.h" //For BitGrid
+#include "aStar.h" //For directions
+
+const uint16_t FIELDFAR = 0xFFFF; //Distance of a block, or an unreachable cell
+const uint FIELDMAX = 0xFFFE; //Furthest distance held
+
+class FlowField
+{
+  public:
+    const BitGrid& board;
+    std::vector<uint16_t> dist; //Per cell (y * w + x)
+    Coord goal;
+    bool built;
+    bool truncated; //Some cell was too far away to hold
+    uint expanded; //Cells given a distance in the last build or update
+
+    FlowField(const BitGrid&);
+    void build(Coord); //Fill the field out from a find
+    void cellChanged(uint, uint); //A cell of the board has been blocked or cleared
+    uint16_t at(uint y, uint x) const { return dist[y * board.w + x]; }
+    bool next(Coord, Coord&) const; //The step on from a cell toward the find, or false if there is none
+    bool path(Coord, std::vector<Coord>&) const; //From the start to next to the find, or false if it cannot be reached
+
+  private:
+    std::vector<uint> queue;
+    std::vector<uint16_t> was; //Distances of the queued cells when a block cut them off
+    std::vector<std::pair<uint, uint> > lower; //Min-heap of cells to lower, as (distance, cell)
+
+    bool open(uint y, uint x) const { return y < board.h && x < board.w && !board.get(y, x); }
+    void settle(); //Lower distances outward from the cells in the heap
+};
+
+FlowField::FlowField(const BitGrid& Board) : board(Board), built(false), truncated(false), expanded(0) {}
+
+void FlowField::build(Coord Goal)
+{
+    goal = Goal;
+    truncated = false;
+    expanded = 0;
+    dist.assign(board.h * board.w, FIELDFAR);
+    queue.clear();
+    const int around[5][2] = {{0, 0}, {-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (uint a = 0; a < 5; a++)
+    {
+        uint y = goal.y + around[a][0], x = goal.x + around[a][1];
+        if (!open(y, x)) { continue; }
+        dist[y * board.w + x] = 0;
+        queue.push_back(y * board.w + x);
+    }
+    for (uint q = 0; q < queue.size(); q++)
+    {
+        uint c = queue[q], cy = c / board.w, cx = c % board.w, d = dist[c] + 1;
+        if (d > FIELDMAX) { truncated = true; continue; }
+        for (uint dir = 0; dir < 4; dir++)
+        {
+            uint ny = cy + dirY[dir], nx = cx + dirX[dir];
+            if (!open(ny, nx) || dist[ny * board.w + nx] != FIELDFAR) { continue; }
+            dist[ny * board.w + nx] = d;
+            queue.push_back(ny * board.w + nx);
+        }
+    }
+    expanded = queue.size();
+    built = true;
+}
+
+void FlowField::cellChanged(uint y, uint x)
+{
+    if (!built) { return; }
+    if (dist.size() != board.h * board.w || adjacentTo(y, x, goal.y, goal.x)) { built = false; return; } //Resized, or a cell the field starts from: build afresh
+    uint i = y * board.w + x;
+    expanded = 0;
+    lower.clear();
+    if (!board.get(y, x)) //Cleared: take the best distance around it, and spread it
+    {
+        if (dist[i] != FIELDFAR) { return; } //Already open
+        uint best = FIELDFAR;
+        for (uint d = 0; d < 4; d++)
+        {
+            uint ny = y + dirY[d], nx = x + dirX[d];
+            if (open(ny, nx)) { best = std::min(best, dist[ny * board.w + nx] + 1u); }
+        }
+        if (best > FIELDMAX) { return; } //Nothing reachable around it
+        dist[i] = best;
+        lower.push_back(std::make_pair(best, i));
+        settle();
+        return;
+    }
+  //Blocked: cut off the cells that only led to the find through it, a layer at a time
+    if (dist[i] == FIELDFAR) { return; } //Was unreachable anyway
+    queue.assign(1, i);
+    was.assign(1, dist[i]);
+    dist[i] = FIELDFAR;
+    for (uint q = 0; q < queue.size(); q++)
+    {
+        uint c = queue[q], cy = c / board.w, cx = c % board.w;
+        for (uint d = 0; d < 4; d++)
+        {
+            uint ny = cy + dirY[d], nx = cx + dirX[d];
+            if (!open(ny, nx)) { continue; }
+            uint n = ny * board.w + nx;
+            if (dist[n] != was[q] + 1u) { continue; } //Not led to the find through c
+            bool held = false; //By another neighbour as close as c was
+            for (uint e = 0; e < 4 && !held; e++)
+            {
+                uint my = ny + dirY[e], mx = nx + dirX[e];
+                held = open(my, mx) && dist[my * board.w + mx] == was[q];
+            }
+            if (held) { continue; }
+            queue.push_back(n);
+            was.push_back(dist[n]);
+            dist[n] = FIELDFAR;
+        }
+    }
+  //Give the cut off cells the best distance from the cells around them, then spread it
+    for (uint q = 1; q < queue.size(); q++)
+    {
+        uint c = queue[q], cy = c / board.w, cx = c % board.w, best = FIELDFAR;
+        for (uint d = 0; d < 4; d++)
+        {
+            uint ny = cy + dirY[d], nx = cx + dirX[d];
+            if (open(ny, nx)) { best = std::min(best, dist[ny * board.w + nx] + 1u); }
+        }
+        if (best > FIELDMAX) { continue; }
+        dist[c] = best;
+        lower.push_back(std::make_pair(best, c));
+    }
+    std::make_heap(lower.begin(), lower.end(), std::greater<std::pair<uint, uint> >());
+    settle();
+}
+
+void FlowField::settle()
+{
+    while (!lower.empty())
+    {
+        std::pop_heap(lower.begin(), lower.end(), std::greater<std::pair<uint, uint> >());
+        uint d = lower.back().first, c = lower.back().second;
+        lower.pop_back();
+        if (dist[c] != d) { continue; } //Lowered again since
+        expanded++;
+        if (d + 1 > FIELDMAX) { truncated = true; continue; }
+        uint cy = c / board.w, cx = c % board.w;
+        for (uint dir = 0; dir < 4; dir++)
+        {
+            uint ny = cy + dirY[dir], nx = cx + dirX[dir];
+            if (!open(ny, nx) || dist[ny * board.w + nx] <= d + 1) { continue; }
+            dist[ny * board.w + nx] = d + 1;
+            lower.push_back(std::make_pair(d + 1, ny * board.w + nx));
+            std::push_heap(lower.begin(), lower.end(), std::greater<std::pair<uint, uint> >());
+        }
+    }
+}
+
+bool FlowField::next(Coord c, Coord& to) const
+{
+    uint d = at(c.y, c.x), best = FIELDFAR; //A block's distance is FIELDFAR, so any reachable neighbour will do
+    for (uint dir = 0; dir < 4; dir++)
+    {
+        uint ny = c.y + dirY[dir], nx = c.x + dirX[dir];
+        if (!open(ny, nx) || dist[ny * board.w + nx] >= std::min(d, best)) { continue; }
+        best = dist[ny * board.w + nx];
+        to.y = ny;
+        to.x = nx;
+        if (best + 1 == d) { break; } //As close as it gets
+    }
+    return best != FIELDFAR;
+}
+
+bool FlowField::path(Coord start, std::vector<Coord>& out) const
+{
+    out.assign(1, start);
+    if (adjacentTo(start.y, start.x, goal.y, goal.x)) { return true; }
+    Coord c = start;
+    while (at(c.y, c.x) != 0)
+    {
+        if (!next(c, c)) { out.clear(); return false; }
+        out.push_back(c);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,203 @@
+//===================================
+//Packed grid storage
+//===================================
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector> //For the grid tiles
+#include <stdint.h> //For uint64_t
+#include <string.h> //For memset
+#include <algorithm> //For fill
+#include <sys/mman.h> //For releasing a mapped file, whose tiles we may be using
+
+typedef unsigned char byte;
+typedef unsigned int uint;
+
+struct Coord
+{
+    uint y;
+    uint x;
+};
+
+const uint TILEBITS = 6; //Tiles are 64x64 cells
+const uint TILE = 1 << TILEBITS;
+
+class BitGrid //One bit per cell, in 64x64 tiles of 64 row words which are only allocated once a cell in them is set
+{
+  public:
+    uint h;
+    uint w;
+    uint tilesW; //Tiles per row of tiles
+    std::vector<uint64_t*> tiles; //Every tile, pointing at zeroTile until it is touched
+    std::vector<uint> touched; //Indexes of the tiles we have allocated or adopted
+    void* mapBase; //A mapped file some tiles may be adopted from, released with the grid
+    size_t mapSize;
+
+    BitGrid(uint, uint);
+    ~BitGrid();
+    void resize(uint, uint); //Resize to an empty grid, releasing all tiles
+    bool get(uint y, uint x) const { return tiles[(y >> TILEBITS) * tilesW + (x >> TILEBITS)][y & (TILE - 1)] >> (x & 63) & 1; }
+    void set(uint y, uint x) { tileFor(y, x)[y & (TILE - 1)] |= (uint64_t)1 << (x & 63); }
+    void reset(uint y, uint x) { uint64_t* t = tiles[(y >> TILEBITS) * tilesW + (x >> TILEBITS)]; if (t != zeroTile) { t[y & (TILE - 1)] &= ~((uint64_t)1 << (x & 63)); } }
+    void put(uint y, uint x, bool v) { if (v) { set(y, x); } else { reset(y, x); } }
+    void touch(uint y, uint x) { tileFor(y, x); } //Allocate the tile holding a cell, so it can be set from several threads at once
+    void setShared(uint y, uint x) { __atomic_fetch_or(&tiles[(y >> TILEBITS) * tilesW + (x >> TILEBITS)][y & (TILE - 1)], (uint64_t)1 << (x & 63), __ATOMIC_RELAXED); } //As set(), racing other threads; the tile must be touched
+    bool getShared(uint y, uint x) const { return __atomic_load_n(&tiles[(y >> TILEBITS) * tilesW + (x >> TILEBITS)][y & (TILE - 1)], __ATOMIC_RELAXED) >> (x & 63) & 1; } //As get(), racing setShared() and resetShared()
+    void resetShared(uint y, uint x) { uint64_t* t = tiles[(y >> TILEBITS) * tilesW + (x >> TILEBITS)]; if (t != zeroTile) { __atomic_fetch_and(&t[y & (TILE - 1)], ~((uint64_t)1 << (x & 63)), __ATOMIC_RELAXED); } }
+    uint64_t word(uint y, uint wx) const { return tiles[(y >> TILEBITS) * tilesW + wx][y & (TILE - 1)]; } //Cells wx * 64 to wx * 64 + 63 of row y
+    void setWord(uint y, uint wx, uint64_t bits) { if (bits || tiles[(y >> TILEBITS) * tilesW + wx] != zeroTile) { tileFor(y, wx << TILEBITS)[y & (TILE - 1)] = bits; } }
+    void adoptTile(uint t, uint64_t* tile) { tiles[t] = tile; touched.push_back(t); } //Use memory we do not own (within the mapping) as a tile
+    void adoptMapping(void* base, size_t size) { mapBase = base; mapSize = size; }
+    void clear(); //Zero every touched tile, keeping them allocated for reuse
+    bool any() const;
+    uint count() const;
+
+  private:
+    static uint64_t zeroTile[TILE];
+    uint64_t* tileFor(uint, uint); //The tile holding a cell, allocating it if it is still the zero tile
+    void release(); //Free our tiles and unmap any mapping
+    BitGrid(const BitGrid&);
+    BitGrid& operator=(const BitGrid&);
+};
+
+uint64_t BitGrid::zeroTile[TILE];
+
+BitGrid::BitGrid(uint H, uint W) : h(0), w(0), tilesW(0), mapBase(NULL), mapSize(0)
+{
+    resize(H, W);
+}
+
+BitGrid::~BitGrid()
+{
+    release();
+}
+
+void BitGrid::release()
+{
+    for (uint i = 0; i < touched.size(); i++)
+    {
+        char* t = (char*)tiles[touched[i]];
+        if (t < (char*)mapBase || t >= (char*)mapBase + mapSize) { delete[] tiles[touched[i]]; } //Adopted tiles go with the mapping
+    }
+    touched.clear();
+    if (mapBase) { munmap(mapBase, mapSize); }
+    mapBase = NULL;
+    mapSize = 0;
+}
+
+void BitGrid::resize(uint H, uint W)
+{
+    release();
+    h = H;
+    w = W;
+    tilesW = (W + TILE - 1) >> TILEBITS;
+    tiles.assign(((H + TILE - 1) >> TILEBITS) * tilesW, zeroTile);
+}
+
+uint64_t* BitGrid::tileFor(uint y, uint x)
+{
+    uint t = (y >> TILEBITS) * tilesW + (x >> TILEBITS);
+    if (tiles[t] == zeroTile)
+    {
+        tiles[t] = new uint64_t[TILE]();
+        touched.push_back(t);
+    }
+    return tiles[t];
+}
+
+void BitGrid::clear()
+{
+    for (uint i = 0; i < touched.size(); i++) { memset(tiles[touched[i]], 0, TILE * sizeof(uint64_t)); }
+}
+
+bool BitGrid::any() const
+{
+    for (uint i = 0; i < touched.size(); i++)
+    {
+        for (uint r = 0; r < TILE; r++) { if (tiles[touched[i]][r]) { return true; } }
+    }
+    return false;
+}
+
+uint BitGrid::count() const
+{
+    uint n = 0;
+    for (uint i = 0; i < touched.size(); i++)
+    {
+        for (uint r = 0; r < TILE; r++) { n += __builtin_popcountll(tiles[touched[i]][r]); }
+    }
+    return n;
+}
+
+template <typename T>
+class TiledGrid //One T per cell, in 64x64 tiles which are only allocated once a cell in them is written
+{
+  public:
+    uint h;
+    uint w;
+    uint tilesW;
+    std::vector<T*> tiles; //NULL until touched
+    std::vector<uint> touched;
+
+    TiledGrid(uint = 0, uint = 0);
+    ~TiledGrid();
+    void resize(uint, uint); //Resize to an empty grid, releasing all tiles
+    T get(uint y, uint x) const { T* t = tiles[(y >> TILEBITS) * tilesW + (x >> TILEBITS)]; return t ? t[((y & (TILE - 1)) << TILEBITS) | (x & (TILE - 1))] : T(); }
+    T& at(uint y, uint x) { return tileFor(y, x)[((y & (TILE - 1)) << TILEBITS) | (x & (TILE - 1))]; }
+    void clear(); //Reset every touched cell, keeping the tiles allocated for reuse
+
+  private:
+    T* tileFor(uint, uint);
+    TiledGrid(const TiledGrid&);
+    TiledGrid& operator=(const TiledGrid&);
+};
+
+template <typename T>
+TiledGrid<T>::TiledGrid(uint H, uint W) : h(0), w(0), tilesW(0)
+{
+    resize(H, W);
+}
+
+template <typename T>
+TiledGrid<T>::~TiledGrid()
+{
+    for (uint i = 0; i < touched.size(); i++) { delete[] tiles[touched[i]]; }
+}
+
+template <typename T>
+void TiledGrid<T>::resize(uint H, uint W)
+{
+    for (uint i = 0; i < touched.size(); i++) { delete[] tiles[touched[i]]; }
+    touched.clear();
+    h = H;
+    w = W;
+    tilesW = (W + TILE - 1) >> TILEBITS;
+    tiles.assign(((H + TILE - 1) >> TILEBITS) * tilesW, (T*)NULL);
+}
+
+template <typename T>
+T* TiledGrid<T>::tileFor(uint y, uint x)
+{
+    uint t = (y >> TILEBITS) * tilesW + (x >> TILEBITS);
+    if (!tiles[t])
+    {
+        tiles[t] = new T[TILE * TILE]();
+        touched.push_back(t);
+    }
+    return tiles[t];
+}
+
+template <typename T>
+void TiledGrid<T>::clear()
+{
+    for (uint i = 0; i < touched.size(); i++) { std::fill(tiles[touched[i]], tiles[touched[i]] + TILE * TILE, T()); }
+}
+
+inline bool adjacentTo(uint Y, uint X, uint maybeY, uint maybeX) //Is that position N/E/S/W of us, or are we on top of it?
+{
+    uint dy = Y > maybeY ? Y - maybeY : maybeY - Y;
+    uint dx = X > maybeX ? X - maybeX : maybeX - X;
+    return dy + dx <= 1;
+}
+
+#endif
@@ -0,0 +1,470 @@
+//===================================
+//Hierarchical path finding (HPA*) for long queries
+//  - The board is cut into CLUSTER x CLUSTER clusters. Wherever a run of open cells faces another across a cluster border,
+//    the run is an entrance: one pair of facing cells at its middle, or at both ends if it is ENTRANCESPLIT or longer
+//  - Each entrance cell is a node of an abstract graph. It is one step from the cell facing it, and each cluster caches
+//    the distance between every pair of its nodes, within the cluster. Entrances are found for every cluster up front, but
+//    distances, and the search's state for the nodes, are only worked out and allocated once a search reaches the cluster
+//  - A query links the start and the find to the nodes of their clusters, searches the abstract graph with A*,
+//    then refines each abstract edge into cells with a breadth-first search inside its cluster
+//  - Searches inside a cluster flood a layer at a time, with each row of the cluster as a bit mask
+//  - When a cell of the board changes, only its cluster's nodes are gathered again, along with the borders it lies on
+//    and the clusters on the other side of them; their distances are dropped, to be redone when next needed
+//Moves are 4-connected; reaching the find or any position N/E/S/W of it is success
+//Paths are near-optimal, and a query fails only when there is no path at all
+//===================================
+#ifndef HPA_H
+#define HPA_H
+
+#include <vector> //For clusters, the open heap and the path
+#include <algorithm> //For the open heap
+#include <stdint.h> //For uint16_t
+#include "grid.h" //For BitGrid
+#include "aStar.h" //For directions
+#include "replanner.h" //For INF
+
+const uint CLUSTER = 16; //Cluster width and height, in cells (a power of 2 up to 32, so a cluster's row is in one board word)
+const uint CLUSTERNODES = 4 * CLUSTER; //Most nodes a cluster may have
+const uint ENTRANCESPLIT = 6; //Entrances this wide or wider get a node at each end
+const uint16_t FAR = 0xFFFF; //Cached distance between unconnected nodes
+
+struct HpaNode //A node's state in the abstract search
+{
+    uint gen; //Query this node was last reached in; any other query sees it unreached
+    uint g;
+    uint parent;
+    uint toGoal; //Steps to the find, for nodes in a cluster the find (or next to it) is in, else INF
+    bool closed;
+};
+
+struct Cluster
+{
+    std::vector<Coord> nodes; //Entrance cells, border by border: N, E, S, W
+    uint first[5]; //Index of each border's first node, and then the count
+    std::vector<uint16_t> dist; //Steps from node i to node j, inside the cluster (i * count + j), or FAR
+    bool linked; //Is dist worked out?
+    std::vector<HpaNode> state; //By node, once the abstract search has reached one
+};
+
+struct StartLink //An abstract edge out of the start
+{
+    uint id; //The node reached, or the goal
+    uint steps;
+    Coord via; //The cell flooded from: the start, or an open cell next to it in another cluster (the start may be a blocked cell on a border)
+    Coord to; //The cell reached
+};
+
+struct HpaOpen
+{
+    uint f;
+    uint g;
+    uint id;
+    bool operator>(const HpaOpen& o) const { return f != o.f ? f > o.f : g < o.g; } //Prefer the deeper of equal nodes
+};
+
+class Abstraction
+{
+  public:
+    const BitGrid& board;
+    std::vector<Cluster> clusters;
+    std::vector<std::vector<uint> > eastGates; //Each cluster's entrances to its east neighbour, as rows from its top
+    std::vector<std::vector<uint> > southGates; //Each cluster's entrances to its south neighbour, as columns from its left
+    uint clustersH;
+    uint clustersW;
+    uint expanded; //Abstract nodes expanded by the last search
+    bool built;
+
+    Abstraction(const BitGrid&);
+    void build(); //Find every entrance, leaving the clusters' distances to be worked out as searches reach them
+    void cellChanged(uint, uint); //A cell of the board has been blocked or cleared
+    bool search(Coord, Coord, std::vector<Coord>&); //Search from start to find, building first if need be, giving the path from start to (next to) the find
+
+  private:
+  //The abstract search
+    HpaNode ends[2]; //The start and the goal, whose ids come after every cluster's nodes (cluster * CLUSTERNODES + node)
+    std::vector<HpaOpen> open; //Min-heap, pruned lazily
+    uint gen;
+    Coord start;
+    Coord find;
+    std::vector<StartLink> startLinks;
+  //The local search, inside one cluster
+    std::vector<uint16_t> steps; //Steps to the nearest source, by cell in the cluster
+    uint y0, x0, y1, x1; //The cluster searched, [y0, y1) x [x0, x1)
+
+    uint clusterOf(uint y, uint x) const { return (y / CLUSTER) * clustersW + x / CLUSTER; }
+    void bounds(uint);
+    void findGates(uint, bool); //Find the entrances from a cluster to its east (or south) neighbour
+    void gather(uint); //Gather a cluster's nodes from its borders, dropping any distances cached for it
+    const Cluster& link(uint); //A cluster, caching its nodes' distances first if need be
+    void flood(const std::vector<Coord>&, uint); //Breadth-first search in a cluster from the sources (which may be blocked, as the start may be)
+    uint stepsTo(uint y, uint x) const { return steps[(y - y0) * CLUSTER + (x - x0)]; }
+    void walk(Coord, std::vector<Coord>&); //Follow the last flood from a cell back to its sources, adding the cells after it
+    void walkOut(Coord, std::vector<Coord>&); //Follow the last flood from its source out to a cell, adding the cells after the source
+    uint partner(uint) const; //The node facing a node across its border
+    HpaNode& node(uint);
+    uint heuristic(uint) const;
+    void reach(uint, uint, uint);
+    bool goalCells(uint, std::vector<Coord>&); //The open cells of a cluster at or next to the find, returning false if none are
+    void linkStart(Coord, uint); //Flood from a cell, linking the start to each node and goal cell reached, at so many steps more
+    void refine(const std::vector<uint>&, std::vector<Coord>&);
+};
+
+Abstraction::Abstraction(const BitGrid& Board) : board(Board), clustersH(0), clustersW(0), expanded(0), built(false), gen(0), steps(CLUSTER * CLUSTER) {}
+
+void Abstraction::bounds(uint c)
+{
+    y0 = c / clustersW * CLUSTER;
+    x0 = c % clustersW * CLUSTER;
+    y1 = std::min(y0 + CLUSTER, board.h);
+    x1 = std::min(x0 + CLUSTER, board.w);
+}
+
+void Abstraction::build()
+{
+    clustersH = (board.h + CLUSTER - 1) / CLUSTER;
+    clustersW = (board.w + CLUSTER - 1) / CLUSTER;
+    uint n = clustersH * clustersW;
+    clusters.assign(n, Cluster());
+    eastGates.assign(n, std::vector<uint>());
+    southGates.assign(n, std::vector<uint>());
+    for (uint c = 0; c < n; c++) { findGates(c, true); findGates(c, false); }
+    for (uint c = 0; c < n; c++) { gather(c); }
+    ends[0] = ends[1] = HpaNode();
+    gen = 0;
+    built = true;
+}
+
+void Abstraction::findGates(uint c, bool east)
+{
+    std::vector<uint>& gates = east ? eastGates[c] : southGates[c];
+    gates.clear();
+    bounds(c);
+    if (east ? x1 == board.w : y1 == board.h) { return; } //No neighbour that way
+    uint len = east ? y1 - y0 : x1 - x0, run = 0;
+    for (uint i = 0; i <= len; i++)
+    {
+        bool open = i < len && (east ? !board.get(y0 + i, x1 - 1) && !board.get(y0 + i, x1) : !board.get(y1 - 1, x0 + i) && !board.get(y1, x0 + i));
+        if (open) { run++; continue; }
+        if (!run) { continue; }
+        if (run < ENTRANCESPLIT) { gates.push_back(i - 1 - (run - 1) / 2); } //The middle
+        else { gates.push_back(i - run); gates.push_back(i - 1); } //Both ends
+        run = 0;
+    }
+}
+
+void Abstraction::gather(uint c)
+{
+    Cluster& cl = clusters[c];
+    bounds(c);
+    uint cx = c % clustersW;
+    cl.nodes.clear();
+    cl.first[0] = 0;
+    if (y0) { const std::vector<uint>& g = southGates[c - clustersW]; for (uint t = 0; t < g.size(); t++) { cl.nodes.push_back({y0, x0 + g[t]}); } }
+    cl.first[1] = cl.nodes.size();
+    const std::vector<uint>& e = eastGates[c];
+    for (uint t = 0; t < e.size(); t++) { cl.nodes.push_back({y0 + e[t], x1 - 1}); }
+    cl.first[2] = cl.nodes.size();
+    const std::vector<uint>& s = southGates[c];
+    for (uint t = 0; t < s.size(); t++) { cl.nodes.push_back({y1 - 1, x0 + s[t]}); }
+    cl.first[3] = cl.nodes.size();
+    if (cx) { const std::vector<uint>& g = eastGates[c - 1]; for (uint t = 0; t < g.size(); t++) { cl.nodes.push_back({y0 + g[t], x0}); } }
+    cl.first[4] = cl.nodes.size();
+    cl.dist.clear();
+    cl.linked = false;
+    cl.state.clear();
+}
+
+const Cluster& Abstraction::link(uint c)
+{
+    Cluster& cl = clusters[c];
+    if (cl.linked) { return cl; }
+  //Flood from each node to find its distance to every other
+    uint n = cl.nodes.size();
+    cl.dist.assign(n * n, FAR);
+    std::vector<Coord> source(1);
+    for (uint i = 0; i < n; i++)
+    {
+        source[0] = cl.nodes[i];
+        flood(source, c);
+        for (uint j = 0; j < n; j++) { cl.dist[i * n + j] = stepsTo(cl.nodes[j].y, cl.nodes[j].x); }
+    }
+    cl.linked = true;
+    return cl;
+}
+
+void Abstraction::cellChanged(uint y, uint x)
+{
+    if (!built) { return; }
+    if (clustersH != (board.h + CLUSTER - 1) / CLUSTER || clustersW != (board.w + CLUSTER - 1) / CLUSTER) { built = false; return; } //Resized: build afresh at the next search
+    uint c = clusterOf(y, x);
+    bounds(c);
+    uint top = y0, left = x0, bottom = y1, right = x1; //As finding gates moves the bounds
+  //Redo any border the cell lies on, and the cluster beyond it
+    std::vector<uint> redo(1, c);
+    if (y == top && top) { findGates(c - clustersW, false); redo.push_back(c - clustersW); }
+    if (x == right - 1 && right < board.w) { findGates(c, true); redo.push_back(c + 1); }
+    if (y == bottom - 1 && bottom < board.h) { findGates(c, false); redo.push_back(c + clustersW); }
+    if (x == left && left) { findGates(c - 1, true); redo.push_back(c - 1); }
+    for (uint r = 0; r < redo.size(); r++) { gather(redo[r]); }
+}
+
+void Abstraction::flood(const std::vector<Coord>& sources, uint c) //A layer at a time, a row of the cluster to a word
+{
+    bounds(c);
+    uint rows = y1 - y0;
+    uint32_t open[CLUSTER], seen[CLUSTER], layer[CLUSTER], next[CLUSTER];
+    for (uint r = 0; r < rows; r++)
+    {
+        open[r] = ~(uint32_t)(board.word(y0 + r, x0 >> 6) >> (x0 & 63)) & (uint32_t)(((uint64_t)1 << (x1 - x0)) - 1);
+        seen[r] = layer[r] = 0;
+    }
+    std::fill(steps.begin(), steps.end(), FAR);
+    for (uint s = 0; s < sources.size(); s++)
+    {
+        uint r = sources[s].y - y0, col = sources[s].x - x0;
+        layer[r] |= 1u << col;
+        seen[r] |= 1u << col;
+        steps[r * CLUSTER + col] = 0;
+    }
+    for (uint16_t d = 1; ; d++)
+    {
+        uint32_t any = 0;
+        for (uint r = 0; r < rows; r++)
+        {
+            uint32_t n = layer[r] << 1 | layer[r] >> 1;
+            if (r) { n |= layer[r - 1]; }
+            if (r + 1 < rows) { n |= layer[r + 1]; }
+            next[r] = n & open[r] & ~seen[r];
+            any |= next[r];
+        }
+        if (!any) { return; }
+        for (uint r = 0; r < rows; r++)
+        {
+            layer[r] = next[r];
+            seen[r] |= next[r];
+            for (uint32_t bits = next[r]; bits; bits &= bits - 1) { steps[r * CLUSTER + __builtin_ctz(bits)] = d; }
+        }
+    }
+}
+
+void Abstraction::walk(Coord from, std::vector<Coord>& path)
+{
+    uint y = from.y, x = from.x;
+    for (uint s = stepsTo(y, x); s; s--)
+    {
+        for (uint d = 0; d < 4; d++) //Onto any neighbour a step nearer
+        {
+            uint ny = y + dirY[d], nx = x + dirX[d];
+            if (ny >= y0 && ny < y1 && nx >= x0 && nx < x1 && stepsTo(ny, nx) == s - 1) { y = ny; x = nx; break; }
+        }
+        path.push_back({y, x});
+    }
+}
+
+void Abstraction::walkOut(Coord to, std::vector<Coord>& path)
+{
+    if (!stepsTo(to.y, to.x)) { return; } //At the source
+    uint from = path.size();
+    walk(to, path); //Back to the source
+    path.pop_back(); //The source, already on the path
+    std::reverse(path.begin() + from, path.end());
+    path.push_back(to);
+}
+
+uint Abstraction::partner(uint id) const
+{
+    uint c = id / CLUSTERNODES, i = id % CLUSTERNODES;
+    const Cluster& cl = clusters[c];
+    uint b = 0;
+    while (i >= cl.first[b + 1]) { b++; }
+    const uint beyond[4] = {c - clustersW, c + 1, c + clustersW, c - 1};
+    uint p = beyond[b];
+    return p * CLUSTERNODES + clusters[p].first[(b + 2) & 3] + (i - cl.first[b]);
+}
+
+HpaNode& Abstraction::node(uint id)
+{
+    uint c = id / CLUSTERNODES;
+    if (c < clusters.size() && clusters[c].state.empty()) { clusters[c].state.assign(clusters[c].nodes.size(), HpaNode()); }
+    HpaNode& n = c < clusters.size() ? clusters[c].state[id % CLUSTERNODES] : ends[id % CLUSTERNODES];
+    if (n.gen != gen)
+    {
+        n.gen = gen;
+        n.g = n.toGoal = INF;
+        n.closed = false;
+    }
+    return n;
+}
+
+uint Abstraction::heuristic(uint id) const //Steps to next to the find
+{
+    uint y, x;
+    if (id == clusters.size() * CLUSTERNODES) { y = start.y; x = start.x; }
+    else if (id > clusters.size() * CLUSTERNODES) { return 0; }
+    else { const Coord& c = clusters[id / CLUSTERNODES].nodes[id % CLUSTERNODES]; y = c.y; x = c.x; }
+    uint dy = y > find.y ? y - find.y : find.y - y, dx = x > find.x ? x - find.x : find.x - x;
+    return dy + dx ? dy + dx - 1 : 0;
+}
+
+void Abstraction::reach(uint id, uint g, uint parent)
+{
+    HpaNode& n = node(id);
+    if (n.closed || g >= n.g) { return; }
+    n.g = g;
+    n.parent = parent;
+    open.push_back({g + heuristic(id), g, id});
+    std::push_heap(open.begin(), open.end(), std::greater<HpaOpen>());
+}
+
+bool Abstraction::goalCells(uint c, std::vector<Coord>& cells)
+{
+    bounds(c);
+    cells.clear();
+    const int around[5][2] = {{0, 0}, {-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (uint a = 0; a < 5; a++)
+    {
+        uint y = find.y + around[a][0], x = find.x + around[a][1];
+        if (y >= y0 && y < y1 && x >= x0 && x < x1 && !board.get(y, x)) { cells.push_back({y, x}); }
+    }
+    return !cells.empty();
+}
+
+void Abstraction::linkStart(Coord via, uint more)
+{
+    uint c = clusterOf(via.y, via.x), goalId = clusters.size() * CLUSTERNODES + 1;
+    std::vector<Coord> cells(1, via);
+    flood(cells, c);
+    const Cluster& cl = clusters[c];
+    for (uint i = 0; i < cl.first[4]; i++)
+    {
+        uint s = stepsTo(cl.nodes[i].y, cl.nodes[i].x);
+        if (s != FAR) { startLinks.push_back({c * CLUSTERNODES + i, s + more, via, cl.nodes[i]}); }
+    }
+    if (!goalCells(c, cells)) { return; }
+    for (uint i = 0; i < cells.size(); i++)
+    {
+        uint s = stepsTo(cells[i].y, cells[i].x);
+        if (s != FAR) { startLinks.push_back({goalId, s + more, via, cells[i]}); }
+    }
+}
+
+bool Abstraction::search(Coord Start, Coord Find, std::vector<Coord>& path)
+{
+    path.clear();
+    expanded = 0;
+    if (!built || clustersH != (board.h + CLUSTER - 1) / CLUSTER || clustersW != (board.w + CLUSTER - 1) / CLUSTER) { build(); }
+    start = Start;
+    find = Find;
+    if (!++gen) //Wrapped: forget every earlier query
+    {
+        for (uint c = 0; c < clusters.size(); c++) { clusters[c].state.clear(); }
+        ends[0].gen = ends[1].gen = 0;
+        gen = 1;
+    }
+    open.clear();
+    uint startId = clusters.size() * CLUSTERNODES, goalId = startId + 1;
+  //Link the start to the nodes of its cluster, and of any cluster next to it, and to the find if it is reached there
+    startLinks.clear();
+    linkStart(start, 0);
+    uint sc = clusterOf(start.y, start.x);
+    for (uint d = 0; d < 4; d++)
+    {
+        uint y = start.y + dirY[d], x = start.x + dirX[d];
+        if (y < board.h && x < board.w && clusterOf(y, x) != sc && !board.get(y, x)) { linkStart({y, x}, 1); }
+    }
+    std::vector<Coord> cells;
+  //Link the find: every node of a cluster the find (or a cell next to it) is in gets its steps there
+    uint seen[5], seenN = 0;
+    const int around[5][2] = {{0, 0}, {-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (uint a = 0; a < 5; a++)
+    {
+        uint y = find.y + around[a][0], x = find.x + around[a][1];
+        if (y >= board.h || x >= board.w) { continue; }
+        uint c = clusterOf(y, x);
+        if (std::find(seen, seen + seenN, c) != seen + seenN) { continue; }
+        seen[seenN++] = c;
+        if (!goalCells(c, cells)) { continue; }
+        flood(cells, c);
+        const Cluster& cl = clusters[c];
+        for (uint i = 0; i < cl.first[4]; i++)
+        {
+            uint s = stepsTo(cl.nodes[i].y, cl.nodes[i].x);
+            if (s != FAR) { node(c * CLUSTERNODES + i).toGoal = s; }
+        }
+    }
+  //A* over the abstract graph
+    reach(startId, 0, startId);
+    while (!open.empty())
+    {
+        uint id = open.front().id;
+        std::pop_heap(open.begin(), open.end(), std::greater<HpaOpen>());
+        open.pop_back();
+        HpaNode& n = node(id);
+        if (n.closed) { continue; }
+        n.closed = true;
+        expanded++;
+        if (id == goalId)
+        {
+            std::vector<uint> route;
+            for (uint r = goalId; r != startId; r = node(r).parent) { route.push_back(r); }
+            route.push_back(startId);
+            std::reverse(route.begin(), route.end());
+            refine(route, path);
+            return true;
+        }
+        if (id == startId)
+        {
+            for (uint l = 0; l < startLinks.size(); l++) { reach(startLinks[l].id, startLinks[l].steps, id); }
+            continue;
+        }
+        uint c = id / CLUSTERNODES, i = id % CLUSTERNODES, g = n.g;
+        const Cluster& cl = link(c);
+        uint count = cl.first[4];
+        reach(partner(id), g + 1, id);
+        for (uint j = 0; j < count; j++)
+        {
+            uint16_t d = cl.dist[i * count + j];
+            if (d != FAR && j != i) { reach(c * CLUSTERNODES + j, g + d, id); }
+        }
+        if (n.toGoal != INF) { reach(goalId, g + n.toGoal, id); }
+    }
+    return false;
+}
+
+void Abstraction::refine(const std::vector<uint>& route, std::vector<Coord>& path) //Turn the abstract route into cells
+{
+    uint startId = clusters.size() * CLUSTERNODES, goalId = startId + 1;
+    std::vector<Coord> cells(1, start);
+    path.assign(1, start);
+    for (uint r = 0; r + 1 < route.size(); r++)
+    {
+        uint a = route[r], b = route[r + 1];
+        if (a == startId) //Out of the start, which may be blocked, so flood from it rather than to it
+        {
+            const StartLink* link = NULL;
+            for (uint l = 0; l < startLinks.size(); l++)
+            {
+                if (startLinks[l].id == b && (!link || startLinks[l].steps < link->steps)) { link = &startLinks[l]; }
+            }
+            if (link->via.y != start.y || link->via.x != start.x) { path.push_back(link->via); }
+            cells.assign(1, link->via);
+            flood(cells, clusterOf(link->via.y, link->via.x));
+            walkOut(link->to, path);
+            continue;
+        }
+        uint c = a / CLUSTERNODES;
+        if (b == goalId) //Into the find, in this cluster
+        {
+            goalCells(c, cells);
+        } else if (c != b / CLUSTERNODES) { //Across a border
+            path.push_back(clusters[b / CLUSTERNODES].nodes[b % CLUSTERNODES]);
+            continue;
+        } else { //Between two nodes of one cluster
+            cells.assign(1, clusters[c].nodes[b % CLUSTERNODES]);
+        }
+        flood(cells, c);
+        walk(clusters[c].nodes[a % CLUSTERNODES], path);
+    }
+}
+
+#endif
@@ -0,0 +1,216 @@
+//===================================
+//Loading boards from map files, which are memory-mapped rather than read
+//  - Moving AI benchmark maps (.map) are parsed straight out of the mapping into the board's words
+//  - Scenario files (.scen) give the queries that go with them
+//  - PatFind binary maps (.pfb) hold the board's own tiles, which the board adopts in place
+//===================================
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <sys/mman.h> //For mmap
+#include <sys/stat.h> //For fstat
+#include <fcntl.h> //For open
+#include <unistd.h> //For close
+#include <stdio.h> //For writing binary maps
+#include <stdlib.h> //For strtod
+#include <vector> //For scenarios
+#include <algorithm> //For min
+#include "grid.h" //For BitGrid
+
+/*PatFind binary map layout (little-endian)
+    "PFB1", uint32 height, uint32 width, uint32 tile count
+    uint32 per tile of the board, in row-major tile order: 0 if the tile is empty, else 1 + its slot in the tile data
+    Zero padding up to a multiple of PFBALIGN bytes
+    Tile data: 64 row words per tile, exactly as a BitGrid holds them
+*/
+const char PFBMAGIC[4] = {'P', 'F', 'B', '1'};
+const uint PFBALIGN = TILE * sizeof(uint64_t);
+
+struct Scenario //A query from a .scen file
+{
+    Coord start;
+    Coord find;
+    double optimal; //Its optimal (octile) length, as given
+};
+
+struct MappedFile
+{
+    char* data;
+    size_t size;
+};
+
+bool mapFile(const char* path, MappedFile& f) //Map a whole file privately: we may write to it, but it is copy-on-write and never reaches the file
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) || !st.st_size) { close(fd); return false; }
+    void* p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { return false; }
+    f.data = (char*)p;
+    f.size = st.st_size;
+    return true;
+}
+
+//For parsing text out of a mapping, which is not null-terminated
+inline const char* skipSpace(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) { p++; }
+    return p;
+}
+
+inline const char* skipWord(const char* p, const char* end)
+{
+    p = skipSpace(p, end);
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') { p++; }
+    return p;
+}
+
+inline const char* readUint(const char* p, const char* end, uint& n)
+{
+    p = skipSpace(p, end);
+    for (n = 0; p < end && *p >= '0' && *p <= '9'; p++) { n = n * 10 + (*p - '0'); }
+    return p;
+}
+
+inline const char* readDouble(const char* p, const char* end, double& d)
+{
+    char num[32];
+    uint n = 0;
+    p = skipSpace(p, end);
+    while (p < end && n < sizeof(num) - 1 && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') { num[n++] = *p++; }
+    num[n] = 0;
+    d = strtod(num, NULL);
+    return p;
+}
+
+bool parseMovingAIMap(const MappedFile& f, BitGrid& board)
+{
+    const char* p = f.data;
+    const char* end = f.data + f.size;
+    uint h = 0, w = 0;
+  //Header: "type octile", "height H", "width W", "map"
+    while (p < end)
+    {
+        p = skipSpace(p, end);
+        const char* word = p;
+        p = skipWord(p, end);
+        if (p - word == 6 && !strncmp(word, "height", 6)) { p = readUint(p, end, h); }
+        else if (p - word == 5 && !strncmp(word, "width", 5)) { p = readUint(p, end, w); }
+        else if (p - word == 3 && !strncmp(word, "map", 3)) { break; }
+        else { p = skipWord(p, end); } //The type
+    }
+    if (!h || !w) { return false; }
+    board.resize(h, w);
+  //Rows: '.', 'G' and 'S' are passable; anything else ('@', 'O', 'T', 'W') is a block
+    for (uint y = 0; y < h; y++)
+    {
+        while (p < end && (*p == '\r' || *p == '\n')) { p++; }
+        if ((size_t)(end - p) < w) { return false; }
+        for (uint wx = 0; wx < board.tilesW; wx++)
+        {
+            uint64_t bits = 0;
+            uint xlen = std::min(w - (wx << TILEBITS), TILE);
+            for (uint x = 0; x < xlen; x++)
+            {
+                char c = p[x];
+                if (c != '.' && c != 'G' && c != 'S') { bits |= (uint64_t)1 << x; }
+            }
+            board.setWord(y, wx, bits);
+            p += xlen;
+        }
+    }
+    return true;
+}
+
+bool adoptBinaryMap(const MappedFile& f, BitGrid& board)
+{
+    if (f.size < 16) { return false; }
+    const uint32_t* head = (const uint32_t*)f.data;
+    uint h = head[1], w = head[2], tileCount = head[3];
+    board.resize(h, w);
+    size_t nTiles = board.tiles.size();
+    size_t dataOff = (16 + nTiles * sizeof(uint32_t) + PFBALIGN - 1) / PFBALIGN * PFBALIGN;
+    if (f.size < dataOff + (size_t)tileCount * PFBALIGN) { return false; }
+    const uint32_t* index = head + 4;
+    for (uint t = 0; t < nTiles; t++) { if (index[t] > tileCount) { return false; } }
+    board.adoptMapping(f.data, f.size);
+    for (uint t = 0; t < nTiles; t++)
+    {
+        if (index[t]) { board.adoptTile(t, (uint64_t*)(f.data + dataOff + (size_t)(index[t] - 1) * PFBALIGN)); }
+    }
+    return true;
+}
+
+bool loadMap(const char* path, BitGrid& board) //Load a Moving AI or PatFind binary map
+{
+    MappedFile f;
+    if (!mapFile(path, f)) { return false; }
+    if (f.size >= 4 && !memcmp(f.data, PFBMAGIC, 4))
+    {
+        if (adoptBinaryMap(f, board)) { return true; } //The board now holds the mapping
+        munmap(f.data, f.size);
+        return false;
+    }
+    bool ok = parseMovingAIMap(f, board);
+    munmap(f.data, f.size);
+    return ok;
+}
+
+bool saveBinaryMap(const char* path, const BitGrid& board)
+{
+    FILE* out = fopen(path, "wb");
+    if (!out) { return false; }
+    std::vector<uint32_t> index(board.tiles.size(), 0);
+    std::vector<uint> slots; //Tiles with a block in them, in the order they are written
+    for (uint t = 0; t < board.tiles.size(); t++)
+    {
+        for (uint r = 0; r < TILE; r++)
+        {
+            if (board.tiles[t][r])
+            {
+                slots.push_back(t);
+                index[t] = slots.size();
+                break;
+            }
+        }
+    }
+    uint32_t head[4] = {0, board.h, board.w, (uint32_t)slots.size()};
+    memcpy(head, PFBMAGIC, 4);
+    fwrite(head, sizeof(head), 1, out);
+    fwrite(index.data(), sizeof(uint32_t), index.size(), out);
+    size_t written = sizeof(head) + index.size() * sizeof(uint32_t);
+    for (; written % PFBALIGN; written++) { fputc(0, out); }
+    for (uint s = 0; s < slots.size(); s++) { fwrite(board.tiles[slots[s]], sizeof(uint64_t), TILE, out); }
+    return !fclose(out);
+}
+
+bool loadScenarios(const char* path, std::vector<Scenario>& scens) //Lines of: bucket map width height startX startY goalX goalY optimal
+{
+    MappedFile f;
+    if (!mapFile(path, f)) { return false; }
+    const char* p = f.data;
+    const char* end = f.data + f.size;
+    p = skipSpace(p, end);
+    if (end - p >= 7 && !strncmp(p, "version", 7)) { p = skipWord(skipWord(p, end), end); }
+    while ((p = skipSpace(p, end)) < end)
+    {
+        uint bucket, mw, mh;
+        Scenario s;
+        p = readUint(p, end, bucket);
+        p = skipWord(p, end); //The map's name
+        p = readUint(p, end, mw);
+        p = readUint(p, end, mh);
+        p = readUint(p, end, s.start.x);
+        p = readUint(p, end, s.start.y);
+        p = readUint(p, end, s.find.x);
+        p = readUint(p, end, s.find.y);
+        p = readDouble(p, end, s.optimal);
+        scens.push_back(s);
+    }
+    munmap(f.data, f.size);
+    return true;
+}
+
+#endif
@@ -0,0 +1,144 @@
+//===================================
+//Solving one query on several threads, by advancing its branches in rounds
+//  - Each round, the closest alive branches are taken from the frontier, and split between the threads to advance (steps #4 to #7)
+//  - A branch may only move into a cell it claims for the round by compare-and-set, so no two branches move into one cell at once;
+//    a branch beaten to a cell waits for the next round. 'No-go', shadow, been and grave marks are set with atomic ORs
+//  - History points and new branches come from space set aside as the round begins, so threads never grow the pools
+//  - Once every thread is done, the branches advanced, and those split off, are queued on the frontier by the caller
+//  - Rounds are sized by work: waking the threads costs microseconds, and a branch's step a fraction of one, so a round is only
+//    tried while ROUNDMIN branches per thread are alive, and only shared out if that many are within ROUNDBAND cells of the
+//    closest one's distance to the find (fewer are advanced by the calling thread alone). Otherwise the calling thread steps
+//    the closest branch, as PathFinder::findPath() does. Workers sleep on a condition variable between rounds, and never spin
+//  - Keeping to the band stops rounds splitting off branches the serial search would never step, which used the pool up
+//The closest-first search seldom has that many branches alive, so on most boards this runs as findPath() does, and where it
+//does share rounds (big open boards) it has measured slower: it does not cut single-query latency (use BatchSolver for throughput)
+//Which thread wins a claim changes from run to run, so paths may differ between runs (unlike PathFinder::findPath())
+//===================================
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <vector> //For the branches of a round
+#include <thread> //For the workers
+#include <mutex> //For waking workers between rounds
+#include <condition_variable> //Likewise
+#include "pathFinder.h" //For PathFinder
+
+const uint ROUNDCHUNK = 4; //Branches a thread takes at a time
+const uint ROUNDMIN = 32; //Fewest branches per thread that make a round worth sharing out
+const uint ROUNDBAND = 2; //A round only takes branches this many cells further from the find than the closest
+
+class ParallelFinder
+{
+  public:
+    PathFinder finder; //Its options (straighten, scan, branchMax) apply as usual
+    uint width; //Most branches advanced in a shared round (at least, and by default, ROUNDMIN per thread)
+
+    ParallelFinder(const BitGrid&, uint = 0, uint = 0, uint = BRANCHMAX); //Board, threads (0 for one per core), width, branch pool size
+    ~ParallelFinder();
+    PathResult findPath(Coord, Coord); //Search with the branch engine until success or timeout
+    uint threads() const { return pool.size() + 1; }
+    uint rounds; //Rounds shared out in the last search
+
+  private:
+    std::vector<std::thread> pool; //Workers beside the calling thread
+    std::vector<Branch*> picked; //This round's branches
+    std::vector<Branch*> born; //The branch each of them split off, if any
+    uint next; //Index of the next picked branch to be taken
+    uint round; //Count of rounds begun; workers wake when it changes
+    uint running; //Workers yet to finish this round
+    bool stopping;
+    std::mutex lock; //Guards round, running and stopping
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    void loop(); //A worker thread: wait for a round, work on it, repeat
+    void work(); //Advance picked branches until none are left
+    ParallelFinder(const ParallelFinder&);
+    ParallelFinder& operator=(const ParallelFinder&);
+};
+
+ParallelFinder::ParallelFinder(const BitGrid& Board, uint threads, uint Width, uint branchMax) : finder(Board, branchMax), width(Width), rounds(0), next(0), round(0), running(0), stopping(false)
+{
+    if (!threads) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+    for (uint t = 1; t < threads; t++) { pool.push_back(std::thread(&ParallelFinder::loop, this)); }
+}
+
+ParallelFinder::~ParallelFinder()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (uint t = 0; t < pool.size(); t++) { pool[t].join(); }
+}
+
+PathResult ParallelFinder::findPath(Coord Start, Coord Find)
+{
+    finder.begin(Start, Find);
+    rounds = 0;
+    uint least = ROUNDMIN * threads(); //Branches alive to be worth a round
+    while (true)
+    {
+        if (pool.empty() || finder.aliveBs < least) //Too few to share out: step the closest, as the serial search does
+        {
+            if (!finder.step()) { break; }
+            continue;
+        }
+        if (!finder.beginRound(picked, std::max(width, least), ROUNDBAND)) { break; }
+        if (picked.empty()) { continue; }
+        born.assign(picked.size(), (Branch*)NULL);
+        next = 0;
+        bool shared = picked.size() >= least; //The pool may be too full to take as many
+        if (shared)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                running = pool.size();
+                round++;
+            }
+            wake.notify_all();
+            rounds++;
+        }
+      //Work alongside the pool, then wait for it
+        work();
+        if (shared)
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (running) { done.wait(guard); }
+        }
+        finder.endRound(picked, born);
+    }
+    return finder.result;
+}
+
+void ParallelFinder::loop()
+{
+    uint seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (round == seen && !stopping) { wake.wait(guard); }
+            if (stopping) { return; }
+            seen = round;
+        }
+        work();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running--;
+        }
+        done.notify_one();
+    }
+}
+
+void ParallelFinder::work()
+{
+    uint n = picked.size();
+    for (uint i; (i = __atomic_fetch_add(&next, ROUNDCHUNK, __ATOMIC_RELAXED)) < n; )
+    {
+        for (uint p = i; p < std::min(i + ROUNDCHUNK, n); p++) { born[p] = finder.advance(picked[p]); }
+    }
+}
+
+#endif
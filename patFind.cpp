@@ -1,13 +1,13 @@
 /*Path finding method:
 #1  Create a branch at the start position if no other branches are alive
-#2  Find closest alive/non-'no-go' (and therefore dead) branch to the destination, if flagged to do so
+#2  Find closest alive/non-'no-go' (and therefore dead) branch to the destination, from the frontier heap of alive branches
 #3  Check if the branch is at the destination (or we've timed out)
-    - If we have a path, optimise it by going through the coords, and checking around each one to see if there is a higher valued path point, then skipping to it
+    - If we have a path, optimise it by going through the coords, and skipping from each one to the last point of the path at or next to it (and, if asked, pulling it straight along clear lines)
 #4  Aim the direction to go in (on each axis either no-move, N, E, S, W)
 #5  Try going towards the destination
-#6  If both axis could not be moved into, move the original branch one opposite direction, and a new branch, the other. Mark position of split 'no-go.' Flag that we must calculate new closest.
+#6  If both axis could not be moved into, move the original branch one opposite direction, and a new branch, the other. Mark position of split 'no-go.'
 #7  If one axis does not need to be moved on, and the not-no-move direction cannot be moved on, the original branch should go one
-          direction of the perpendicular axis, and a new branch, and the other. Mark position of split 'no-go.' Flag that we must calculate new closest.
+          direction of the perpendicular axis, and a new branch, and the other. Mark position of split 'no-go.'
     - If both new branches cannot be created, go backwards on the not-no-move aim. Mark position backed away from as 'no-go'
     - If that cannot be created, kill the branch again
 
@@ -29,66 +29,36 @@
 #include <chrono> //For thread sleeping
 #include <time.h> //For time keeping
 #include <cmath> //For math functions
+#include <unistd.h> //For argument parsing: getopt
 #include "keypresses.c" //For detecting keypresses: kbhit(), pressedCh
+#include "pathFinder.h" //For the path finding engine
+#include "batch.h" //For solving queries on a pool of threads
+#include "parallel.h" //For solving one query on several threads
+#include "mapFile.h" //For loading boards from map files
+#include "randBoard.h" //For generating random boards: randBoard(), frand()
+#include "render.h" //For drawing the board
 
 using namespace std;
-typedef unsigned char byte;
-typedef unsigned int uint;
 
-//===================================
-//For optimisation/approx/mathematical code
-//===================================
-uint g_seed = time(NULL);
-inline uint frand()
-{ 
-  g_seed = (214013 * g_seed + 2531011); 
-  return (g_seed >> 16) & 0x7FFF; 
-}
-
-union
-{
-    int tmp;
-    float f;
-} u;
-inline float sqrt_approx(float z)
-{
-    u.f = z;
-    u.tmp -= 1 << 23; /* Subtract 2^m. */
-    u.tmp >>= 1; /* Divide by 2. */
-    u.tmp += 1 << 29; /* Add ((b + 1) / 2) * 2^m. */
-    return u.f;
-}
-
-inline float euclideanDistance(int y1, int x1, int y2, int x2) //Calculate the distance between two points, as the crow flies
-{
-    return sqrt_approx(pow((x2 - x1), 2) + pow((y2 - y1), 2));
-}
-//===================================
-
-uint y, x, ylen, xlen;
-unsigned long i, i2, ilen, i2len;
+const uint boardW = 140; //Size of the board we draw on
+const uint boardH = 40;
 bool run = true;
 bool pfind = false;
 bool haveRun = false;
 unsigned long startTime = time(NULL);
 unsigned long thisTime = time(NULL);
-bool timeout = false;
-
-const uint BRANCHMAX = 1024;
-const uint HISTMAX = 2048;
-const byte OPTIMISE = 32; //Level of path optimisation
-const byte DEADTIMEOUT = 16;
 
-const uint boardW = 140;
-const uint boardH = 40;
 const uint boardWh = boardW / 2;
 const uint boardHh = boardH / 2;
-bool board[boardH][boardW];
-bool bShad[boardH][boardW];
-bool bBeen[boardH][boardW];
-bool grave[boardH][boardW];
-uint foundP[boardH][boardW], pathLen = 0, origPathLen = 0;
-bool* look;
+BitGrid board(boardH, boardW);
+BitGrid foundP(boardH, boardW);
+uint pathLen = 0, origPathLen = 0; //pathLen is also how much of the path has been revealed
+const uint STEPUS = 8000; //Time between steps of the search, so it can be watched
+const uint REVEALMS = 4; //Time to reveal each cell of the found path
+bool revealing = false;
+chrono::steady_clock::time_point revealFrom;
+const uint SHOWCASEPAUSE = 1280; //Time to show a showcase's path for before the next
+chrono::steady_clock::time_point showcaseNext;
 
 uint cursory = boardHh;
 uint cursorx = boardWh;
@@ -97,208 +67,64 @@ int startx = -1;
 int findy = -1;
 int findx = -1;
 bool showcase = false;
+Engine engine = ENGINE_BRANCH;
+bool printStats = false; //In batch mode, follow each query with its stats as JSON
+uint sliceUs = 0; //In batch mode, run each query in slices of this many microseconds
+uint slices = 0; //Slices the last query took
+uint roundThreads = 0; //In batch mode, advance each query's branches in rounds on this many threads
+uint roundWidth = 0; //Most branches in a shared round (0 for ROUNDMIN per thread)
+size_t cacheBytes = 0; //In batch mode, cache found paths in up to this much memory
 
-class Branch
-{
-  public:
-    uint y;
-    uint x;
-    uint yhist[HISTMAX];
-    uint xhist[HISTMAX];
-    uint h; //History count
-    bool successful;
-    bool dead;
-    bool inited;
-    void recHist(bool);
-    void move(char, char, bool);
-    void kill();
-    void resurrect();
-
-  Branch();
-  Branch(uint, uint, uint[HISTMAX], uint[HISTMAX], uint);
-};
-
-Branch::Branch(){}
-
-Branch::Branch(uint Y, uint X, uint Yhist[HISTMAX], uint Xhist[HISTMAX], uint H)
-{
-    y = Y;
-    x = X;
-    for (i = 0; i < HISTMAX; i++) //Copy history array passed
-    {
-        yhist[i] = Yhist[i];
-        xhist[i] = Xhist[i];
-    }
-    h = H;
-    move(0, 0, false); //Set in bShad
-    dead = false;
-    inited = true;
-}
-
-void Branch::recHist(bool overwrite)
-{
-    if (overwrite) { h--; }
-    yhist[h] = y;
-    xhist[h] = x;
-    h++;
-}
-
-void Branch::move(char yd, char xd, bool overHist = false)
-{
-  //Set shadows on the board
-    bShad[y][x] = false;
-    y += yd;
-    x += xd;
-    bShad[y][x] = true;
-  //Record history
-    recHist(overHist);
-    bBeen[y][x] = true;
-    if ((findy < y && yd == -1) || (findy > y && yd == 1) || (findx < x && xd == -1) || (findx > x && xd == 1)) { successful = true; }
-}
-
-void Branch::kill()
-{
-    dead = grave[y][x] = true;
-}
-
-void Branch::resurrect()
-{
-    dead = grave[y][x] = false;
-}
-
-
-Branch* branch[BRANCHMAX];
-uint branches = 0;
-uint aliveBs = 0;
-uint deadBStreak = 0;
-uint b = 0;
-Branch* br;
-bool nogo[boardH][boardW];
-
-Branch* newBranch(uint y, uint x, Branch* b)
-{
-    Branch* B;
-    if (!b->inited) //Are we working as an initial branch (with no history?)
-    {
-        uint yhist[HISTMAX] = {};
-        uint xhist[HISTMAX] = {};
-        B = new Branch(starty, startx, yhist, xhist, 0);
-    } else {
-        B = new Branch(y, x, b->yhist, b->xhist, b->h);
-    }
-    if (!aliveBs) { deadBStreak++; } else { deadBStreak = 0; }
-    if (branches >= BRANCHMAX || deadBStreak == DEADTIMEOUT) //Time out (Have we: run out of branch space; been creating initial branches rather a lot)?
-    {
-        timeout = true;
-    } else {
-        branch[branches] = B;
-        branches++;
-    }
-    aliveBs++;
-    return B;
-}
-
-bool mayMove(uint Y, uint X)
-{
-    if (Y < 0) { return false; }
-    if (Y > boardH - 1) { return false; }
-    if (X < 0) { return false; }
-    if (X > boardW - 1) { return false; }
-    if (board[Y][X]) { nogo[Y][X] = true; return false; }
-    if (nogo[Y][X]) { return false; }
-    return true;
-}
-
-bool adjacentTo(uint Y, uint X, uint maybeY, uint maybeX)
-{
-    if (Y - 1 >= 0)   { if (maybeY == Y - 1 && maybeX == X) { return true; } } //Is North of us?
-    if (X + 1 < boardW) { if (maybeY == Y && maybeX == X + 1) { return true; } } //Is East of us?
-    if (Y + 1 < boardH) { if (maybeY == Y + 1 && maybeX == X) { return true; } } //Is South of us?
-    if (X - 1 >= 0)   { if (maybeY == Y && maybeX == X - 1) { return true; } } //Is West of us?
-    if (Y == maybeY && X == maybeX) { return true; } //Are we on top of that position?
-    return false; //Nope!
-}
-
+PathFinder finder(board);
 
-void clearScreen() { std::cout << "\033[2J\033[1;1H"; }
+Renderer screen(boardH, boardW);
 
-string buffer;
-string buff;
-void display()
+void display() //Compose the frame, drawing it if it is due
 {
-    buffer = "";
-    clearScreen();
-    for (y = 0; y < boardH; y++)
+    if (!screen.due()) { return; }
+    for (uint y = 0; y < boardH; y++)
     {
-        for (x = 0; x < boardW; x++)
+        for (uint x = 0; x < boardW; x++)
         {
-            buff = "\033[0;30;47m ";
-            if (board[y][x])
-            {
-                buff = "\033[0;30;47m#"; //Block
-            }
-            if (bBeen[y][x]) //Branch been
+            char ch = board.get(y, x) ? '#' : ' '; //Block
+            Colour fg = BLACK, bg = WHITE;
+            if (finder.bBeen.get(y, x)) { fg = WHITE; bg = CYAN; } //Branch been
+            if (finder.nogo.get(y, x)) { fg = WHITE; bg = RED; } //Nogo
+            if (finder.bShad.get(y, x)) //Branch
             {
-                buff = buff.substr(buff.length() - 1, buff.length());
-                buff = "\033[37;46m" + buff;
+                ch = '+';
+                fg = BLACK;
+                bg = finder.grave.get(y, x) ? YELLOW : GREEN;
             }
-            if (nogo[y][x]) //Nogo
-            {
-                buff = buff.substr(buff.length() - 1, buff.length());
-                buff = "\033[37;41m" + buff;
-            }
-            if (bShad[y][x]) //Branch
-            {
-                if (!grave[y][x])
-                {
-                    buff = "\033[0;30;42m+";
-                } else {
-                    buff = "\033[0;30;43m+";
-                }
-            }
-            if (foundP[y][x]) //Found path
-            {
-                buff = buff.substr(buff.length() - 1, buff.length());
-                buff = "\033[37;44m" + buff;
-            }
-            if (y == starty && x == startx) //Start
-            {
-                buff = "\033[0;30;45m@";
-            }
-            if (y == findy && x == findx) //Find
-            {
-                buff = "\033[0;30;42m@";
-            }
-            if (y == cursory && x == cursorx) //Cursor
-            {
-                buff = buff.substr(buff.length() - 1, buff.length());
-                buff = "\033[37;40m" + buff;
-            }
-            buffer += buff;
+            if (foundP.get(y, x)) { fg = WHITE; bg = BLUE; } //Found path
+            if ((int)y == starty && (int)x == startx) { ch = '@'; fg = BLACK; bg = MAGENTA; } //Start
+            if ((int)y == findy && (int)x == findx) { ch = '@'; fg = BLACK; bg = GREEN; } //Find
+            if (y == cursory && x == cursorx) { fg = WHITE; bg = BLACK; } //Cursor
+            screen.put(y, x, ch, fg, bg);
         }
-        buffer += "\033[0m\n";
     }
-    buffer += std::to_string(cursorx) + ", " + std::to_string(cursory);
+    string status = std::to_string(cursorx) + ", " + std::to_string(cursory) + "  " + ENGINENAMES[engine];
     if (pfind || haveRun || showcase)
     {
         if (pfind)
         {
             if (!showcase)
             {
-                buffer += "  FINDING  ";
+                status += "  FINDING  ";
             } else {
-                buffer += "  SHOWCASING  ";
+                status += "  SHOWCASING  ";
             }
         } else {
-            buffer += "  HAVE RUN (";
-            if (timeout) { buffer += "TIMEOUT"; } else { buffer += "SUCCESS/PAUSE"; }
-            buffer += ")  ";
+            status += "  HAVE RUN (";
+            if (finder.timeout) { status += "TIMEOUT"; } else { status += "SUCCESS/PAUSE"; }
+            status += ")  ";
         }
-        buffer += "len: " + to_string(pathLen) + " (opti'd by " + to_string(origPathLen - pathLen) +  ")  ";
-        buffer += to_string(thisTime - startTime) + "s";
-        buffer += "  branches: " + to_string(branches) + "  alive: " + to_string(aliveBs);
+        status += "len: " + to_string(pathLen) + " (opti'd by " + to_string(origPathLen - pathLen) +  ")  ";
+        status += to_string(thisTime - startTime) + "s";
+        status += "  branches: " + to_string(finder.branches) + "  alive: " + to_string(finder.aliveBs);
     }
-    cout << buffer << endl;
+    screen.status(status);
+    screen.flush();
 }
 
 bool inputted;
@@ -328,102 +154,256 @@ string getInput()
 void cleanUp()
 {
     haveRun = false;
-    timeout = false;
-    deadBStreak = 0;
-    //for (b = 0; b < branches; b++) { delete branch[b]; } //Go through each branch, and delete
-    memset(branch, 0, sizeof(branch)); //Remove all existing branch pointers
-    branches = 0;
-    aliveBs = 0;
-    for (y = 0; y < boardH; y++) //Clear arrays
+    finder.cleanUp();
+    foundP.clear();
+    revealing = false;
+    pathLen = origPathLen = 0;
+}
+
+void randBoard(char mode) //Generate the board, and random start and find positions
+{
+    Coord start, find;
+    randBoard(board, mode);
+    finder.boardChanged();
+    randEnds(board, start, find);
+    starty = start.y;
+    startx = start.x;
+    findy = find.y;
+    findx = find.x;
+}
+
+void beginFind()
+{
+    finder.begin({(uint)starty, (uint)startx}, {(uint)findy, (uint)findx}, engine);
+    startTime = thisTime = time(NULL);
+}
+
+void revealPath() //Lay more of the found path into foundP, as its reveal time passes
+{
+    uint upTo = finder.result.path.size();
+    if (revealing)
     {
-        for (x = 0; x < boardW; x++)
+        uint due = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - revealFrom).count() / REVEALMS;
+        if (due < upTo) { upTo = due; } else { revealing = false; }
+    }
+    for (; pathLen < upTo; pathLen++) { foundP.set(finder.result.path[pathLen].y, finder.result.path[pathLen].x); }
+}
+
+void showPath(bool animate) //Render the found path, a cell every REVEALMS if animating
+{
+    foundP.clear();
+    pathLen = origPathLen = 0;
+    origPathLen = finder.result.origLen;
+    revealing = animate;
+    revealFrom = chrono::steady_clock::now();
+    revealPath();
+}
+
+void findStep() //Advance the search, revealing the found path once it is over
+{
+    if (finder.step()) { thisTime = time(NULL); return; }
+    pfind = false;
+    showPath(true);
+}
+
+bool inBounds(int sy, int sx, int fy, int fx)
+{
+    return sy >= 0 && sx >= 0 && fy >= 0 && fx >= 0 && sy < (int)board.h && sx < (int)board.w && fy < (int)board.h && fx < (int)board.w;
+}
+
+void printResult(int sy, int sx, int fy, int fx, const PathResult& res, unsigned long long tookNs)
+{
+    cout << sy << " " << sx << " " << fy << " " << fx << ": ";
+    if (!inBounds(sy, sx, fy, fx))
+    {
+        cout << "OUT OF BOUNDS" << endl;
+        return;
+    }
+    if (!res.found)
+    {
+        cout << "TIMEOUT";
+    } else {
+        cout << "SUCCESS len: " << res.path.size() << " (opti'd by " << res.origLen - res.path.size() << ")";
+    }
+    cout << "  " << tookNs / 1000 << "us  branches: " << res.branches;
+    if (sliceUs) { cout << "  slices: " << slices; }
+    if (res.found)
+    {
+        cout << "  path:";
+        for (uint i = 0; i < res.path.size(); i++) { cout << " " << res.path[i].y << "," << res.path[i].x; }
+    }
+    cout << endl;
+    if (printStats) { cout << "stats: " << res.stats.json() << endl; }
+}
+
+void solveQuery(int sy, int sx, int fy, int fx) //Solve and print one query
+{
+    PathResult res = PathResult();
+    unsigned long long tookNs = 0;
+    if (inBounds(sy, sx, fy, fx))
+    {
+        chrono::steady_clock::time_point began = chrono::steady_clock::now();
+        if (sliceUs) //Spread the search over slices, as a caller with a budget per tick would
         {
-            nogo[y][x] = false;
-            bShad[y][x] = false;
-            bBeen[y][x] = false;
-            foundP[y][x] = 0;
+            finder.begin({(uint)sy, (uint)sx}, {(uint)fy, (uint)fx}, engine);
+            for (slices = 1; finder.run(0, sliceUs) == SEARCH_RUNNING; slices++) {}
+            res = finder.result;
+        } else if (roundThreads && engine == ENGINE_BRANCH) {
+            static ParallelFinder par(board, roundThreads, roundWidth, finder.branchMax);
+            par.finder.straighten = finder.straighten;
+            par.finder.scan = finder.scan;
+            par.finder.fallback = finder.fallback;
+            res = par.findPath({(uint)sy, (uint)sx}, {(uint)fy, (uint)fx});
+        } else {
+            res = finder.findPath({(uint)sy, (uint)sx}, {(uint)fy, (uint)fx}, engine);
         }
+        tookNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - began).count();
     }
+    printResult(sy, sx, fy, fx, res, tookNs);
 }
 
-void randBoard(char mode)
+void solveAll(const vector<int>& ends, uint threads) //Solve every query (4 ints each) across a pool of threads, then print them in order
 {
-    for (y = 0; y < boardH; y++)
+    vector<Query> queries;
+    for (uint i = 0; i < ends.size(); i += 4) { queries.push_back({{(uint)ends[i], (uint)ends[i + 1]}, {(uint)ends[i + 2], (uint)ends[i + 3]}}); } //Negatives wrap, so are out of bounds
+    vector<PathResult> results;
+    vector<unsigned long long> tookNs;
+    BatchSolver pool(board, threads, finder.branchMax);
+    pool.straighten(finder.straighten);
+    pool.scan(finder.scan);
+    pool.bidirectional(finder.bidirectional);
+    pool.fallback(finder.fallback);
+    pool.cache(cacheBytes);
+    chrono::steady_clock::time_point began = chrono::steady_clock::now();
+    pool.solve(queries, results, engine, &tookNs);
+    unsigned long long totalNs = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - began).count();
+    for (uint q = 0; q < queries.size(); q++) { printResult(ends[q * 4], ends[q * 4 + 1], ends[q * 4 + 2], ends[q * 4 + 3], results[q], tookNs[q]); }
+    cerr << queries.size() << " queries on " << pool.threads() << " threads in " << totalNs / 1000 << "us" << endl;
+}
+
+int runBatch(const char* mapPath, const char* scenPath, const char* savePath, uint threads) //Headless: solve each query flat out, on a pool of threads if asked
+{
+    string line;
+    vector<int> ends; //Queries saved up for the pool
+    if (mapPath)
     {
-        for (x = 0; x < boardW; x++)
+        if (!loadMap(mapPath, board)) { cerr << "Could not load map " << mapPath << endl; return 1; }
+    } else {
+      //Read the board, one row per line ('#' is a block), ending at a blank line; it is as large as the rows given
+        vector<string> rows;
+        uint w = 0;
+        while (getline(cin, line) && !line.empty())
         {
-            switch (mode)
+            rows.push_back(line);
+            if (line.length() > w) { w = line.length(); }
+        }
+        board.resize(rows.size(), w);
+        for (uint y = 0; y < rows.size(); y++)
+        {
+            for (uint x = 0; x < rows[y].length(); x++)
             {
-                case 'r':
-                    if (!(frand() % 4)) { board[y][x] = 1; }
-                     else { board[y][x] = 0; }
-                    break;
-                case 'l':
-                    if (!(frand() % 8)) { board[y][x] = 1; }
-                     else { board[y][x] = 0; }
-                    break;
-                case 's':
-                    if (!(y % ((frand() % 2) + 8)) != !(x % ((frand() % 2) + 16))) { board[y][x] = 1; }
-                     else { board[y][x] = 0; }
-                    break;
-                case 'm':
-                    board[y][x] = (!((y % 2) + (x % 2)) ? 1 : 0);
-                    if (frand() % 10 > 5 && (y % 2 == 0 || x % 2 == 0)) { board[y][x] = 1; }
-                    break;
-                case 'c':
-                    board[y][x] = 0;
-                    break;
+                if (rows[y][x] == '#') { board.set(y, x); }
             }
         }
     }
-    if (mode == 'c')
+    if (savePath && !saveBinaryMap(savePath, board)) { cerr << "Could not save map " << savePath << endl; return 1; }
+    if (scenPath)
     {
-        float step = 0.1f;
-        float angle;
-        for (i = 0; i < 16; i++)
+      //Solve each scenario
+        vector<Scenario> scens;
+        if (!loadScenarios(scenPath, scens)) { cerr << "Could not load scenarios " << scenPath << endl; return 1; }
+        for (uint s = 0; s < scens.size(); s++)
         {
-            angle = 0.0f;
-            int size = (frand() % 20) + 10, offY, offX;
-            y = frand() % boardH;
-            x = frand() % boardW;
-            while (angle < 6.28f)
-            {
-              //Calculate the x and y of this part of the circle
-                offY = (size * (float)cos(angle)) / 2;
-                offX = size * (float)sin(angle);
-              //Place obstacle
-                if (y + offY < boardH && x + offX < boardW) { board[y + offY][x + offX] = 1; }
-                angle += step;
-            }
+            Scenario& sc = scens[s];
+            if (threads) { ends.insert(ends.end(), {(int)sc.start.y, (int)sc.start.x, (int)sc.find.y, (int)sc.find.x}); }
+            else { solveQuery(sc.start.y, sc.start.x, sc.find.y, sc.find.x); }
+        }
+    } else {
+      //Solve each "starty startx findy findx" line
+        while (cin >> starty >> startx >> findy >> findx)
+        {
+            if (threads) { ends.insert(ends.end(), {starty, startx, findy, findx}); }
+            else { solveQuery(starty, startx, findy, findx); }
         }
     }
-    do
-    {
-        starty = frand() % boardH;
-        startx = frand() % boardW;
-        findy = frand() % boardH;
-        findx = frand() % boardW;
-    } while (euclideanDistance(starty, startx, findy, findx) < boardW / 2);
+    if (threads) { solveAll(ends, threads); }
+    return 0;
 }
 
-bool moved, success, calcClosest;
-uint prevY, prevX, ed, minEd, useB;
-byte aimY, aimX, movedY, movedX;
-
-int main()
+int main(int argc, char* argv[])
 {
+    bool batch = false;
+    const char* mapPath = NULL;
+    const char* scenPath = NULL;
+    const char* savePath = NULL;
+    uint threads = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "bdfjlvn:m:s:w:e:t:k:p:P:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': //Batch mode
+                batch = true;
+                break;
+            case 'k': //Run queries in slices
+                sliceUs = max(1, atoi(optarg));
+                break;
+            case 'j': //Print stats
+                printStats = true;
+                break;
+            case 'v': //Scan for the closest branch
+                finder.scan = true;
+                break;
+            case 'l': //Pull paths straight along lines of sight
+                finder.straighten = true;
+                break;
+            case 'd': //Search from both ends
+                finder.bidirectional = true;
+                break;
+            case 'f': //Find the exact path when the branch search times out
+                finder.fallback = true;
+                break;
+            case 'n': //Branch pool size
+                finder.branchMax = atoi(optarg);
+                break;
+            case 'm': //Map file
+                mapPath = optarg;
+                break;
+            case 's': //Scenario file
+                scenPath = optarg;
+                break;
+            case 'w': //Write the board out as a binary map
+                savePath = optarg;
+                break;
+            case 'e': //Engine
+                if (!engineByName(optarg, engine)) { cerr << "Unknown engine " << optarg << " (branch, astar, astar8, jps, dlite, hpa, field or bfs)" << endl; return 1; }
+                break;
+            case 't': //Solve on a pool of threads
+                threads = max(1, atoi(optarg));
+                break;
+            case 'p': //Solve each query on several threads
+                roundThreads = max(1, atoi(optarg));
+                break;
+            case 'P': //Most branches per shared round
+                roundWidth = atoi(optarg);
+                break;
+            case 'c': //Cache paths, in KB
+                cacheBytes = (size_t)max(0, atoi(optarg)) * 1024;
+                finder.cache.capacity = cacheBytes;
+                break;
+        }
+    }
+    if (batch) { return runBatch(mapPath, scenPath, savePath, threads); }
   //Load shite to listen to pressed keys
     loadKeyListen();
-    cout << "Patfind, by Patrick Bowen [phunanon] 2016.\nControls: .ueo NESW move, a obstacle, h set start, t set finish, r randomly create, c clear, [space] begin find, [enter] begin showcase\nPress any key to continue.";
+    cout << "Patfind, by Patrick Bowen [phunanon] 2016.\nControls: .ueo NESW move, a obstacle, h set start, t set finish, r randomly create, c clear, g change engine, [space] begin find, [enter] begin showcase\nPress any key to continue.";
     getchar();
 
+    chrono::steady_clock::time_point nextStep = chrono::steady_clock::now();
     while (run)
     {
-        display();
-
         while (kbhit())
         {
-            look = &board[cursory][cursorx];
             pressedCh = getchar(); //Get the key
             switch (pressedCh)
             {
@@ -439,12 +419,14 @@ int main()
                 case 'o': //Left
                     if (cursorx > 0) { cursorx--; }
                     break;
-                case 'a': //Toggle block
-                    *look = !*look;
+                case 'a': //Toggle block, passing it on to the finder's caches, and repairing the path in place if D* Lite found it
+                    board.put(cursory, cursorx, !board.get(cursory, cursorx));
+                    if (finder.cellChanged(cursory, cursorx) && haveRun && !pfind) { showPath(false); }
                     break;
-                case 'h': //Set start
+                case 'h': //Set start, repairing the path in place from there if D* Lite found it
                     starty = cursory;
                     startx = cursorx;
+                    if (finder.startMoved({cursory, cursorx}) && haveRun && !pfind) { showPath(false); }
                     break;
                 case 't': //Set find
                     findy = cursory;
@@ -452,7 +434,7 @@ int main()
                     break;
                 case '\n': //Toggle showcase
                     showcase = !showcase;
-                    if (showcase) { cleanUp(); randBoard('r'); }
+                    if (showcase) { cleanUp(); randBoard('r'); beginFind(); }
                     pfind = showcase;
                     break;
                 case ' ': //Toggle pathfind
@@ -467,7 +449,7 @@ int main()
                             pfind = !pfind;
                             if (pfind)
                             {
-                                startTime = thisTime = time(NULL);
+                                beginFind();
                                 haveRun = true;
                             }
                         }
@@ -480,10 +462,15 @@ int main()
                     while (!kbhit()) { this_thread::sleep_for(chrono::milliseconds(50)); }
                     char mode = getchar();
                     randBoard(mode);
+                    screen.invalidate(); //The prompt is on screen
                 }
                     break;
+                case 'g': //Cycle engine
+                    engine = (Engine)((engine + 1) % ENGINES);
+                    break;
                 case 'c': //Clear
-                    memset(board, 0, sizeof(board));
+                    board.clear();
+                    finder.boardChanged();
                     starty = startx = findy = findx = -1;
                     break;
                 case 'q': //Quit
@@ -493,268 +480,29 @@ int main()
             }
         }
 
-
-
-
-
-        if (pfind)
+      //The search steps on its own clock, the path reveals on another, and the screen is drawn on a third
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (pfind && now >= nextStep)
         {
-            success = false;
-            minEd = boardW * boardH;
-//#1    Create a branch at the start position if no other branches are alive
-            if (aliveBs == 0) //Create an initial/retry branch
-            {
-                newBranch(starty, startx, new Branch());
-            }
-            aliveBs = 0;
-//#2    Find closest branch to the destination, if flagged to do so
-            if (calcClosest)
-            {
-                for (b = 0; b < branches; b++) //Go through each branch, and find the closest alive one
-                {
-                    br = branch[b];
-                    if (nogo[br->y][br->x]) { br->kill(); continue; }
-                    if (!br->dead)
-                    {
-                        ed = euclideanDistance(br->y, br->x, findy, findx);
-                        if (ed < minEd) { minEd = ed; useB = b; }
-                    }
-                    aliveBs++;
-                }
-            }
-            br = branch[useB];
-            pathLen = origPathLen = br->h;
-//#3    Is this branch at the find (or timed out)?
-            if (adjacentTo(br->y, br->x, findy, findx) || timeout) //DID WE FIND IT?... or did we timeout?
-            {
-                pfind = false;
-                pathLen = 0;
-                origPathLen = br->h;
-              //Render found path from history
-                if (!timeout)
-                {
-                    ilen = br->h;
-                    uint ignoreUntil;
-                    for (i = 0; i < ilen; i++)
-                    {
-                        if (!ignoreUntil || i == ignoreUntil)
-                        {
-                            ignoreUntil = 0;
-                            y = br->yhist[i];
-                            x = br->xhist[i];
-                            foundP[y][x] = i;
-                            pathLen++;
-                          //Path optimisation
-                            if (i < ilen - OPTIMISE)
-                            {
-                                i2len = i;
-                                for (i2 = i + OPTIMISE; i2 > i2len; i2--)
-                                {
-                                    if (adjacentTo(br->yhist[i2], br->xhist[i2], y, x))
-                                    {
-                                        ignoreUntil = i2;
-                                        break;
-                                    }
-                                }
-                            }
-                            display();
-                            this_thread::sleep_for(std::chrono::milliseconds(4));
-                        }
-                    }
-                }
-                if (showcase) //Are we showcasing?
-                {
-                    display();
-                    pfind = true;
-                    cleanUp();
-                    char mode = 'r';
-                    if (!(frand() % 5)) { mode = 'l'; }
-                     else if (!(frand() % 4)) { mode = 's'; }
-                     else if (!(frand() % 3)) { mode = 'm'; }
-                     else if (!(frand() % 2)) { mode = 'c'; } 
-                    randBoard(mode);
-                    this_thread::sleep_for(std::chrono::milliseconds(1280));
-                    startTime = thisTime = time(NULL); //For showcasing
-                }
-                continue;
-            }
-//#4    Aim the direction to go in
-            if (br->y == findy) { aimY = 0; } //No-move Y
-            if (br->x == findx) { aimX = 0; } //No-move X
-            if (br->y > findy) { aimY = 1; } //Move North
-            if (br->x < findx) { aimX = 2; } //Move East
-            if (br->y < findy) { aimY = 3; } //Move South
-            if (br->x > findx) { aimX = 4; } //Move West
-//#5    Try going towards the destination
-            prevY = br->y;
-            prevX = br->x;
-            br->successful = false;
-            if (aimY == 1) //North
-            {
-                if (mayMove(br->y - 1, br->x))
-                {
-                    br->move(-1, 0);
-                }
-            }
-            if (aimX == 2) //East
-            {
-                if (mayMove(br->y, br->x + 1))
-                {
-                    br->move(0, 1);
-                }
-            }
-            if (aimY == 3) //South
-            {
-                if (mayMove(br->y + 1, br->x))
-                {
-                    br->move(1, 0);
-                }
-            }
-            if (aimX == 4) //West
-            {
-                if (mayMove(br->y, br->x - 1))
-                {
-                    br->move(0, -1);
-                }
-            }
-
-            if (br->successful) { success = true; } //State that there was success
-
-//#6    Check how we moved 1
-        //If both axis could not be moved into, move the original branch one opposite direction, and a new branch, the other
-            if (aimX != 0 && prevX == br->x && aimY != 0 && prevY == br->y)
-            {
-                calcClosest = true;
-                moved = false;
-              //Mark here as a nogo
-                nogo[br->y][br->x] = true;
-
-                prevY = br->y;
-                prevX = br->x;
-
-              //Make the original branch go in the opposing X direction
-                if (aimX == 4) //To now move East
-                {
-                    if (mayMove(br->y, br->x + 1))
-                    {
-                        br->move(0, 1);
-                        moved = true;
-                    }
-                } else { //To now move West
-                	if (mayMove(br->y, br->x - 1))
-                    {
-                        br->move(0, -1);
-                        moved = true;
-                    }
-                }
-              //If that move didn't work, we're dead!
-                if (!moved)
-                {
-                    br->kill();
-                }
-              //Make a new branch go in the opposing Y direction
-                moved = false;
-                Branch* b2 = newBranch(prevY, prevX, br);
-                if (aimY == 1) //To now move South
-                {
-                    if (mayMove(b2->y + 1, b2->x))
-                    {
-                        b2->move(1, 0);
-                        moved = true;
-                    }
-                } else { //To now move North
-                	if (mayMove(b2->y - 1, b2->x))
-                    {
-                        b2->move(-1, 0);
-                        moved = true;
-                    }
-                }
-                if (!moved)
-                {
-                    b2->kill();
-                }
-            }
-//#7    Check how we moved 2
-          //If one axis does not need to be moved on, and the not-no-move direction cannot be moved on, the original branch should go one direction of the perpendicular axis, and a new branch, and the other
-            if ((aimY == 0 && aimX != 0 && prevX == br->x) || (aimX == 0 && aimY != 0 && prevY == br->y))
-            {
-                calcClosest = true;
-                moved = false;
-              //Mark here as a nogo
-                nogo[br->y][br->x] = true;
-
-                prevY = br->y;
-                prevX = br->x;
-
-                if (aimX != 0)                      //Tried moving East or West - create a branch North and South
-                {
-                    if (mayMove(br->y - 1, br->x))  //Can move original branch North?
-                    {
-                        br->move(-1, 0);
-                        moved = true;
-                    } else {                        //Kill this branch, otherwise
-                        br->kill();
-                    }
-                  //Create a new branch, to move South
-                    Branch* b2 = newBranch(prevY, prevX, br);
-                    if (mayMove(b2->y + 1, b2->x))  //Can move new branch South?
-                    {
-                        b2->move(1, 0);
-                        moved = true;
-                    } else {                        //Kill this branch, otherwise
-                        b2->kill();
-                    }
-                }
-
-                if (aimY != 0) // Tried moving North or South - create a branch East and West
-                {
-                    if (mayMove(br->y, br->x + 1))  //Can move original branch East?
-                    {
-                        br->move(0, 1);
-                        moved = true;
-                    } else {                        //Kill this branch, otherwise
-                        br->kill();
-                    }
-                  //Create a new branch, to move West
-                    Branch* b2 = newBranch(prevY, prevX, br);
-                    if (mayMove(b2->y, b2->x - 1))  //Can move new branch West?
-                    {
-                        b2->move(0, -1);
-                        moved = true;
-                    } else {                        //Kill this branch, otherwise
-                        b2->kill();
-                    }
-                }
-                
-                
-                if (!moved) //If we didn't manage to move either branch, move back on the no-move axis
-                {
-                  //Resurrect the original branch
-                    br->resurrect();
-                  //Move it backwards
-                    if (aimX == 0) //Move it backwards on Y
-                    {
-                        if (mayMove(br->y + (aimY == 1 ? 1 : -1), br->x))
-                        {
-                            br->move((aimY == 1 ? 1 : -1), 0, true);
-                            moved = true;
-                        }
-                    } else { //Move it backwards on X
-                        if (mayMove(br->y, br->x + (aimX == 4 ? 1 : -1)))
-                        {
-                            br->move(0, (aimX == 4 ? 1 : -1), true);
-                            moved = true;
-                        }
-                    }
-                    if (!moved) // If we failed to move, again, kill it again
-                    {
-                        br->kill();
-                    }
-                }
-            }
-            thisTime = time(NULL);
+            findStep();
+            nextStep = now + chrono::microseconds(STEPUS);
+            if (!pfind && showcase) { showcaseNext = now + chrono::milliseconds(finder.result.path.size() * REVEALMS + SHOWCASEPAUSE); }
         }
-        this_thread::sleep_for(std::chrono::milliseconds(8));
+        if (!pfind && showcase && now >= showcaseNext) //Showcasing, and the last path has been shown for long enough?
+        {
+            pfind = true;
+            cleanUp();
+            char mode = 'r';
+            if (!(frand() % 5)) { mode = 'l'; }
+             else if (!(frand() % 4)) { mode = 's'; }
+             else if (!(frand() % 3)) { mode = 'm'; }
+             else if (!(frand() % 2)) { mode = 'c'; } 
+            randBoard(mode);
+            beginFind(); //For showcasing
+        }
+        revealPath();
+        display();
+        this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
     return 0;
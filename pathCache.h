@@ -0,0 +1,167 @@
+//===================================
+//Cache of found paths, by start, find and how they were searched, for callers that ask the same queries again and again
+//  - Least recently used entries are dropped first, to keep under a cap on memory
+//  - Each entry is stamped with the board's generation: replacing the board bumps it, which drops every entry as it is next looked up
+//  - Editing one cell only drops the entries it could make wrong: paths through (or round the corner of) a cell now blocked, 'no path' through one now clear,
+//    and paths longer than the shortest way could be through one now clear (bounded by its octile distance to both ends)
+//===================================
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <vector> //For paths
+#include <list> //For the recency order
+#include <unordered_map> //For looking up entries
+#include <stdint.h> //For uint64_t
+#include <cmath> //For M_SQRT2
+#include <algorithm> //For std::min and std::max
+#include "grid.h" //For Coord
+
+struct CacheKey
+{
+    uint sy;
+    uint sx;
+    uint fy;
+    uint fx;
+    uint how; //The engine, and any options changing the path
+    uint branchMax; //Of the branch pool, which changes the path too
+    bool operator==(const CacheKey& o) const { return sy == o.sy && sx == o.sx && fy == o.fy && fx == o.fx && how == o.how && branchMax == o.branchMax; }
+};
+
+struct CacheKeyHash
+{
+    size_t operator()(const CacheKey& k) const
+    {
+        uint64_t h = ((uint64_t)k.sy << 32 | k.sx) * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint64_t)k.fy << 32 | k.fx) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+        h ^= ((uint64_t)k.branchMax << 32 | k.how) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        return h ^ (h >> 29);
+    }
+};
+
+struct CachedPath
+{
+    bool found;
+    std::vector<Coord> path;
+    uint origLen;
+};
+
+class PathCache
+{
+  public:
+    size_t capacity; //Most bytes to hold, roughly (0 to cache nothing)
+    size_t bytes;
+    uint generation; //Of the board
+    uint64_t hits;
+    uint64_t misses;
+
+    PathCache(size_t = 0);
+    const CachedPath* get(const CacheKey&); //The entry for a query, or NULL; it stays valid until the cache is next changed
+    void put(const CacheKey&, bool, const std::vector<Coord>&, uint);
+    void boardChanged() { generation++; }
+    void cellChanged(uint, uint, bool); //A cell has been blocked (or cleared)
+    void clear();
+    size_t size() const { return lru.size(); }
+
+  private:
+    struct Entry
+    {
+        CacheKey key;
+        uint generation;
+        uint y0, x0, y1, x1; //Bounds of the path
+        double cost; //Of the path: 1 a straight step, sqrt(2) a diagonal one
+        CachedPath result;
+    };
+    typedef std::list<Entry>::iterator Slot;
+    std::list<Entry> lru; //Most recently used first
+    std::unordered_map<CacheKey, Slot, CacheKeyHash> index;
+
+    void erase(Slot);
+    static double octile(uint y, uint x, uint y2, uint x2) //Least cost between two cells, over any moves
+    {
+        uint dy = std::max(y, y2) - std::min(y, y2), dx = std::max(x, x2) - std::min(x, x2);
+        return std::max(dy, dx) + (M_SQRT2 - 1) * std::min(dy, dx);
+    }
+    static size_t cost(const Entry& e) { return sizeof(Entry) + 4 * sizeof(void*) + e.result.path.capacity() * sizeof(Coord); } //With its list and index nodes
+};
+
+PathCache::PathCache(size_t Capacity) : capacity(Capacity), bytes(0), generation(0), hits(0), misses(0) {}
+
+const CachedPath* PathCache::get(const CacheKey& key)
+{
+    std::unordered_map<CacheKey, Slot, CacheKeyHash>::iterator it = index.find(key);
+    if (it == index.end()) { misses++; return NULL; }
+    Slot s = it->second;
+    if (s->generation != generation) { erase(s); misses++; return NULL; } //From an earlier board
+    lru.splice(lru.begin(), lru, s); //Now the most recent
+    hits++;
+    return &s->result;
+}
+
+void PathCache::put(const CacheKey& key, bool found, const std::vector<Coord>& path, uint origLen)
+{
+    if (!capacity) { return; }
+    std::unordered_map<CacheKey, Slot, CacheKeyHash>::iterator it = index.find(key);
+    if (it != index.end()) { erase(it->second); }
+    lru.push_front(Entry());
+    Entry& e = lru.front();
+    e.key = key;
+    e.generation = generation;
+    e.result.found = found;
+    e.result.path = path;
+    e.result.origLen = origLen;
+    e.y0 = e.x0 = (uint)-1;
+    e.y1 = e.x1 = 0;
+    e.cost = 0;
+    for (uint i = 0; i < path.size(); i++)
+    {
+        if (i) { e.cost += path[i].y != path[i - 1].y && path[i].x != path[i - 1].x ? M_SQRT2 : 1; }
+        e.y0 = std::min(e.y0, path[i].y);
+        e.x0 = std::min(e.x0, path[i].x);
+        e.y1 = std::max(e.y1, path[i].y);
+        e.x1 = std::max(e.x1, path[i].x);
+    }
+    index[key] = lru.begin();
+    bytes += cost(e);
+    while (bytes > capacity && !lru.empty()) { erase(--lru.end()); }
+}
+
+void PathCache::erase(Slot s)
+{
+    bytes -= cost(*s);
+    index.erase(s->key);
+    lru.erase(s);
+}
+
+void PathCache::cellChanged(uint y, uint x, bool blocked)
+{
+    for (Slot s = lru.begin(); s != lru.end(); )
+    {
+        Slot e = s++;
+        bool drop = e->generation != generation;
+        if (!drop && blocked && e->result.found && y >= e->y0 && y <= e->y1 && x >= e->x0 && x <= e->x1) //Through the cell, or cutting its corner?
+        {
+            const std::vector<Coord>& path = e->result.path;
+            for (uint i = 0; i < path.size() && !drop; i++)
+            {
+                drop = path[i].y == y && path[i].x == x;
+                if (i && !drop) { drop = (path[i - 1].y == y && path[i].x == x) || (path[i].y == y && path[i - 1].x == x); } //A diagonal step's corners
+            }
+        }
+        if (!drop && !blocked && !e->result.found) { drop = true; } //There may be a way through now
+        if (!drop && !blocked) //A shorter way through? It would cost at least the way to the cell, and on to next to the find
+        {
+            const CacheKey& k = e->key;
+            drop = octile(k.sy, k.sx, y, x) + std::max(0.0, octile(y, x, k.fy, k.fx) - 1) < e->cost - 1e-9;
+        }
+        if (drop) { erase(e); }
+    }
+}
+
+void PathCache::clear()
+{
+    lru.clear();
+    index.clear();
+    bytes = 0;
+}
+
+#endif
@@ -0,0 +1,1044 @@
+//===================================
+//The branch path finding engine (see the method description in patFind.cpp), with A*, Jump Point Search, D* Lite, HPA*, a distance field and bit-parallel BFS alongside it
+//All search state is owned by a PathFinder, and the board it is given is only ever read,
+//so any number of PathFinders may search the same board at once, one per thread
+//One search may also advance many branches at once in rounds, across threads (see parallel.h)
+//or grow branches from both ends, splicing their histories where they meet (bidirectional)
+//===================================
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include <vector> //For the found path
+#include <cmath> //For math functions
+#include <algorithm> //For min, and the frontier heap
+#include "grid.h" //For BitGrid
+#include "aStar.h" //For the A* and Jump Point Search engines
+#include "replanner.h" //For the D* Lite engine
+#include "hpa.h" //For the HPA* engine
+#include "flowField.h" //For the distance field engine
+#include "wavefront.h" //For the bit-parallel BFS engine, and the exact fallback
+#include "components.h" //For turning away queries with no path
+#include "pathCache.h" //For answering repeated queries
+#include "stats.h" //For per-query counters and timings
+#include "branchScan.h" //For finding the closest branch by scanning
+
+const uint BRANCHMAX = 1024; //Default size of the branch pool
+const uint NOHIST = (uint)-1; //Parent of the first history point
+const byte DEADTIMEOUT = 16;
+const uint ROUNDHIST = 4; //Most history points that advancing one branch adds
+const uint PULLMAX = 64; //Longest stretch of path that pullString() pulls straight in one line
+
+//===================================
+//For optimisation/approx/mathematical code
+//===================================
+inline float sqrt_approx(float z)
+{
+    union
+    {
+        int tmp;
+        float f;
+    } u;
+    u.f = z;
+    u.tmp -= 1 << 23; /* Subtract 2^m. */
+    u.tmp >>= 1; /* Divide by 2. */
+    u.tmp += 1 << 29; /* Add ((b + 1) / 2) * 2^m. */
+    return u.f;
+}
+
+inline float euclideanDistance(int y1, int x1, int y2, int x2) //Calculate the distance between two points, as the crow flies
+{
+    return sqrt_approx(pow((x2 - x1), 2) + pow((y2 - y1), 2));
+}
+
+//===================================
+
+struct HistNode //A point in a branch's history; branches split from one another share their parent's points
+{
+    uint y;
+    uint x;
+    uint parent; //Index of the previous point, or NOHIST
+};
+
+struct Frontier //An alive branch waiting to be stepped, in the heap of closest to the find first
+{
+    uint dist; //Squared distance to the find
+    uint b; //Index of the branch
+    uint stamp; //The branch's stamp when queued; if it has moved since, this entry is stale
+    bool operator>(const Frontier& o) const { return dist != o.dist ? dist > o.dist : b > o.b; }
+};
+
+enum Engine //How a query is searched
+{
+    ENGINE_BRANCH, //The branch heuristic, steps #1 to #7
+    ENGINE_ASTAR, //A*, 4-connected with the Manhattan heuristic
+    ENGINE_ASTAR8, //A*, 8-connected with the octile heuristic
+    ENGINE_JPS, //Jump Point Search, 8-connected
+    ENGINE_DLITE, //D* Lite, 4-connected, which repairs its path as the board changes
+    ENGINE_HPA, //HPA*, 4-connected, over clusters of the board found beforehand
+    ENGINE_FIELD, //A distance field out from the find, 4-connected, kept while queries go on heading there
+    ENGINE_BFS //Breadth-first search, 4-connected, 64 cells at a time
+};
+const char* const ENGINENAMES[] = {"branch", "astar", "astar8", "jps", "dlite", "hpa", "field", "bfs"};
+const uint ENGINES = 8;
+
+inline bool engineByName(const char* name, Engine& engine)
+{
+    for (uint e = 0; e < ENGINES; e++)
+    {
+        if (!strcmp(name, ENGINENAMES[e])) { engine = (Engine)e; return true; }
+    }
+    return false;
+}
+
+enum SearchState //Where a budgeted run() has left the search
+{
+    SEARCH_FOUND,
+    SEARCH_FAILED, //Timed out (or, for the other engines, there is no path)
+    SEARCH_RUNNING //Out of budget: result.path holds the best path so far (empty if no branch is alive), and run() may be called again
+};
+
+struct PathResult
+{
+    bool found; //False if we timed out (or, for the other engines, if there is no path)
+    std::vector<Coord> path; //The optimised path, from start to find
+    uint origLen; //Path length before optimisation
+    uint branches; //Branches created
+    uint steps; //Passes of steps #1 to #7, or nodes expanded by the other engines
+    SearchStats stats;
+};
+
+class PathFinder;
+
+class Branch
+{
+  public:
+    PathFinder* pf; //The search we belong to
+    uint y;
+    uint x;
+    uint tip; //Index of our latest history point
+    uint h; //History count
+    uint stamp; //Count of moves, to tell stale frontier entries
+    bool successful;
+    bool dead;
+    void init(PathFinder*, uint, uint, uint, uint);
+    void recHist(bool);
+    void move(char, char, bool);
+    void kill();
+    void resurrect();
+    uint index() const;
+};
+
+class PathFinder
+{
+  public:
+    const BitGrid& board;
+    BitGrid nogo;
+    BitGrid bShad;
+    BitGrid bBeen;
+    BitGrid grave;
+    std::vector<HistNode> hist; //History points of every branch
+    std::vector<Coord> histPath; //A branch's history, laid out when tracing the found path
+    TiledGrid<uint> lastSeen; //1 + the last index of the history at each position, while tracing the found path
+    std::vector<Branch> branch; //Pool of branchMax branches, plus a spare for the one created as we time out
+    std::vector<uint32_t> branchPos; //Each branch's position, packed (see branchScan.h), kept alongside the pool for scanning
+    std::vector<uint32_t> branchDead; //Each branch's dead mask, likewise
+    uint branchMax;
+    uint branches; //Branches in use from the pool
+    uint steps;
+    uint aliveBs;
+    uint deadBStreak;
+    std::vector<Frontier> frontier; //Min-heap of alive branches by distance to the find, pruned lazily
+    bool timeout;
+    bool searching;
+    bool straighten; //Pull the found path straight along clear lines, after cutting its loops
+    bool scan; //Find the closest branch by scanning every branch with SIMD, rather than from the frontier heap (boards up to 32768 square)
+    bool scanning; //Scanning in this search
+    bool bidirectional; //Have findPath() grow branches from the find too, meeting those from the start
+    bool fallback; //When the branch search times out, find the shortest path with the bit-parallel BFS instead
+    PathFinder* reverse; //The search from the find, made at the first bidirectional search
+    bool rounding; //Branches are being advanced by several threads at once, so shared state is changed atomically
+    uint roundNo; //Stamp of the current round in claims
+    uint histUsed; //History points in use while rounding (hist is sized ahead for the round)
+    TiledGrid<uint> claims; //The round each cell was last moved into, so no two branches move into one cell in a round
+    Coord start;
+    Coord find;
+    PathResult result;
+
+    PathFinder(const BitGrid&, uint = BRANCHMAX);
+    ~PathFinder();
+    void cleanUp();
+    AStar astar;
+    Replanner replanner;
+    Abstraction hpa; //Built at the first HPA* search, then kept up to date by cellChanged()
+    WaveFront wave;
+    FlowField field; //Of the last find searched for by the field engine, kept up to date by cellChanged()
+    Components components; //Built at the first search, then kept up to date by cellChanged(), so edits to the board must be passed on
+    PathCache cache; //Of findPath()'s results; give it a capacity to use it
+    Engine engine; //Of the last search
+    std::chrono::steady_clock::time_point began; //When the last search began, for its stats
+
+    void begin(Coord, Coord, Engine = ENGINE_BRANCH); //Start a new search (the other engines run to the end here)
+    bool step(); //One pass of steps #1 to #7, returning false once the search is over
+    PathResult findPath(Coord, Coord, Engine = ENGINE_BRANCH); //Search until success or timeout, or answer from the cache
+    SearchState run(uint, uint = 0); //Carry on the search begun for at most so many steps and microseconds (0 for no limit on either)
+    bool cellChanged(uint, uint); //A cell of the board has been edited: repair the result if it came from D* Lite, else return false
+    bool startMoved(Coord); //The start has moved (as an agent steps along the path): repair the result if it came from D* Lite, else return false
+    void boardChanged(); //The whole board has been replaced or edited: drop anything found from it beforehand
+    Branch* newBranch(uint, uint, Branch*);
+    bool mayMove(uint, uint);
+    void queue(Branch*);
+    Branch* closest();
+    bool beginRound(std::vector<Branch*>&, uint, uint = (uint)-1 >> 1); //Pick up to so many of the closest branches (no more than so many cells further from the find than the closest) to advance at once, returning false once the search is over
+    uint distTo(const Branch* br) const { int dy = br->y - find.y, dx = br->x - find.x; return dy * dy + dx * dx; } //Squared, as on the frontier
+    Branch* advance(Branch*); //Steps #4 to #7 for one branch, giving the new branch it split off, if any; safe on several threads while rounding
+    void endRound(const std::vector<Branch*>&, const std::vector<Branch*>&); //Queue the branches advanced, and those they split off
+    uint addHist(uint, uint, uint); //Add a history point, giving its index
+    bool marked(const BitGrid& g, uint y, uint x) const { return rounding ? g.getShared(y, x) : g.get(y, x); }
+    void mark(BitGrid& g, uint y, uint x) { if (rounding) { g.setShared(y, x); } else { g.set(y, x); } }
+    void unmark(BitGrid& g, uint y, uint x) { if (rounding) { g.resetShared(y, x); } else { g.reset(y, x); } }
+    void count(uint64_t& c) { if (rounding) { __atomic_fetch_add(&c, 1, __ATOMIC_RELAXED); } else { c++; } }
+    void alive(int d) { if (rounding) { __atomic_fetch_add(&aliveBs, d, __ATOMIC_RELAXED); } else { aliveBs += d; } }
+
+  private:
+    bool fromCache(const CacheKey&, Coord, Coord, Engine);
+    void findBoth(Coord, Coord);
+    Branch* stepTouching(const PathFinder&, Coord&); //step(), giving the branch advanced if it is now at or next to a cell the other search has been
+    uint histAt(Coord) const; //Latest history point at a position
+    void splice(const PathFinder&, uint, const PathFinder&, uint); //Trace the path along the forward history to one point, then the reverse history from the other
+    Branch* pick(); //Steps #1 to #3, giving the branch to advance, or NULL if there is none this pass
+    bool claim(uint, uint);
+    void tracePath(Branch*);
+    void cutLoops(); //Build the found path from the history laid out in histPath
+    bool lineClear(Coord, Coord, std::vector<Coord>*);
+    void pullString();
+    void finishStats(std::chrono::steady_clock::time_point);
+    PathFinder(const PathFinder&);
+    PathFinder& operator=(const PathFinder&);
+};
+
+void Branch::init(PathFinder* PF, uint Y, uint X, uint Tip, uint H)
+{
+    pf = PF;
+    y = Y;
+    x = X;
+    tip = Tip; //Share the history passed
+    h = H;
+    stamp = 0;
+    move(0, 0, false); //Set in bShad
+    dead = false;
+    pf->branchDead[index()] = 0;
+}
+
+void Branch::recHist(bool overwrite)
+{
+    if (overwrite && pf->hist[tip].parent != NOHIST) //Backing out: drop the cell backed out of, if the cell before it is next to here, so history stays a walk
+    {
+        const HistNode& before = pf->hist[pf->hist[tip].parent];
+        if (adjacentTo(before.y, before.x, y, x)) { tip = pf->hist[tip].parent; h--; }
+    }
+    tip = pf->addHist(y, x, tip);
+    h++;
+}
+
+void Branch::move(char yd, char xd, bool overHist = false)
+{
+  //Set shadows on the board
+    pf->unmark(pf->bShad, y, x);
+    y += yd;
+    x += xd;
+    stamp++;
+    pf->mark(pf->bShad, y, x);
+    pf->branchPos[index()] = packPos(y, x);
+  //Record history
+    recHist(overHist);
+    pf->mark(pf->bBeen, y, x);
+    uint findy = pf->find.y, findx = pf->find.x;
+    if ((findy < y && yd == -1) || (findy > y && yd == 1) || (findx < x && xd == -1) || (findx > x && xd == 1)) { successful = true; }
+}
+
+void Branch::kill()
+{
+    STAT(pf->count(pf->result.stats.kills));
+    if (!dead) { pf->alive(-1); }
+    dead = true;
+    pf->branchDead[index()] = SCANDEAD;
+    pf->mark(pf->grave, y, x);
+}
+
+uint Branch::index() const
+{
+    return this - &pf->branch[0];
+}
+
+void Branch::resurrect()
+{
+    STAT(pf->count(pf->result.stats.resurrects));
+    if (dead) { pf->alive(1); }
+    dead = false;
+    pf->branchDead[index()] = 0;
+    pf->unmark(pf->grave, y, x);
+}
+
+
+PathFinder::PathFinder(const BitGrid& Board, uint BranchMax) : board(Board), nogo(Board.h, Board.w), bShad(Board.h, Board.w), bBeen(Board.h, Board.w), grave(Board.h, Board.w), lastSeen(Board.h, Board.w), branch(BranchMax + 1), branchMax(BranchMax), straighten(false), scan(false), scanning(false), bidirectional(false), fallback(false), reverse(NULL), rounding(false), roundNo(0), claims(Board.h, Board.w), astar(Board), replanner(Board), hpa(Board), wave(Board), field(Board), components(Board), engine(ENGINE_BRANCH)
+{
+    cleanUp();
+}
+
+PathFinder::~PathFinder()
+{
+    delete reverse;
+}
+
+void PathFinder::cleanUp()
+{
+    timeout = false;
+    searching = false;
+    deadBStreak = 0;
+    branches = 0; //Return all branches to the pool
+    aliveBs = 0;
+    hist.clear();
+    frontier.clear();
+    replanner.planned = false;
+    if (nogo.h != board.h || nogo.w != board.w) //Has the board been resized?
+    {
+        nogo.resize(board.h, board.w);
+        bShad.resize(board.h, board.w);
+        bBeen.resize(board.h, board.w);
+        grave.resize(board.h, board.w);
+        lastSeen.resize(board.h, board.w);
+        claims.resize(board.h, board.w);
+        roundNo = 0;
+    }
+    if (branchPos.size() != branchMax + 1)
+    {
+        branch.resize(branchMax + 1);
+        branchPos.resize(branchMax + 1);
+        branchDead.resize(branchMax + 1);
+    }
+    nogo.clear(); //Clear grids
+    bShad.clear();
+    bBeen.clear();
+    grave.clear();
+    result.found = false;
+    result.path.clear();
+    result.origLen = result.branches = result.steps = 0;
+    result.stats = SearchStats();
+    steps = 0;
+}
+
+void PathFinder::begin(Coord Start, Coord Find, Engine Eng)
+{
+    STAT(std::chrono::steady_clock::time_point cleaning = std::chrono::steady_clock::now());
+    cleanUp();
+    STAT(began = std::chrono::steady_clock::now(); result.stats.cleanNs = std::chrono::duration_cast<std::chrono::nanoseconds>(began - cleaning).count());
+    start = Start;
+    find = Find;
+    engine = Eng;
+    scanning = scan && board.h <= SCANMAX + 1 && board.w <= SCANMAX + 1;
+    if (!components.connected(start, find)) //Walled off from the find: no engine could get there
+    {
+        STAT(finishStats(std::chrono::steady_clock::now()));
+        return;
+    }
+    if (engine == ENGINE_DLITE)
+    {
+        result.found = replanner.plan(start, find, false, result.path);
+        result.origLen = result.path.size();
+        result.steps = replanner.expanded;
+        STAT(finishStats(std::chrono::steady_clock::now()));
+        return;
+    }
+    if (engine == ENGINE_HPA)
+    {
+        result.found = hpa.search(start, find, result.path);
+        result.origLen = result.path.size();
+        result.steps = hpa.expanded;
+        STAT(finishStats(std::chrono::steady_clock::now()));
+        return;
+    }
+    if (engine == ENGINE_BFS)
+    {
+        result.found = wave.search(start, find, &result.path);
+        result.origLen = result.path.size();
+        result.steps = wave.expanded;
+        STAT(finishStats(std::chrono::steady_clock::now()));
+        return;
+    }
+    if (engine == ENGINE_FIELD)
+    {
+        if (!field.built || field.goal.y != find.y || field.goal.x != find.x) { field.build(find); } else { field.expanded = 0; } //Reused: nothing searched
+        result.found = field.path(start, result.path);
+        result.origLen = result.path.size();
+        result.steps = field.expanded;
+        STAT(finishStats(std::chrono::steady_clock::now()));
+        return;
+    }
+    if (engine != ENGINE_BRANCH)
+    {
+        result.found = astar.search(start, find, engine == ENGINE_ASTAR8, engine == ENGINE_JPS, result.path);
+        result.origLen = result.path.size();
+        result.steps = astar.expanded;
+        STAT(finishStats(std::chrono::steady_clock::now()));
+        return;
+    }
+    searching = true;
+}
+
+PathResult PathFinder::findPath(Coord Start, Coord Find, Engine Eng)
+{
+    bool caching = cache.capacity && Eng != ENGINE_DLITE; //D* Lite keeps its plan to repair, so always plans afresh
+    bool both = bidirectional && Eng == ENGINE_BRANCH;
+    CacheKey key = {Start.y, Start.x, Find.y, Find.x, (uint)(Eng | straighten << 4 | both << 5 | fallback << 6), branchMax}; //Everything that changes the path
+    if (caching && fromCache(key, Start, Find, Eng)) { return result; }
+    if (both) { findBoth(Start, Find); }
+    else
+    {
+        begin(Start, Find, Eng);
+        while (step()) {}
+    }
+    if (caching) { cache.put(key, result.found, result.path, result.origLen); }
+    return result;
+}
+
+bool PathFinder::fromCache(const CacheKey& key, Coord Start, Coord Find, Engine Eng)
+{
+    STAT(std::chrono::steady_clock::time_point asked = std::chrono::steady_clock::now());
+    const CachedPath* hit = cache.get(key);
+    if (!hit) { return false; }
+    searching = false;
+    start = Start;
+    find = Find;
+    engine = Eng;
+    result.found = hit->found;
+    result.path = hit->path;
+    result.origLen = hit->origLen;
+    result.branches = result.steps = 0; //No search was run
+    result.stats = SearchStats();
+    STAT(result.stats.totalNs = nsSince(asked));
+    return true;
+}
+
+void PathFinder::findBoth(Coord Start, Coord Find) //Search from the start and from the find in turn, until their branches touch
+{
+    begin(Start, Find);
+    if (!searching) { return; } //Walled off
+    if (!reverse) { reverse = new PathFinder(board, branchMax); }
+    PathFinder& rev = *reverse;
+    rev.branchMax = branchMax;
+    rev.scan = scan;
+    rev.cleanUp();
+    rev.start = Find;
+    rev.find = Start;
+    rev.scanning = scanning;
+    rev.searching = true;
+  //Step each while it is alive; one that times out is left as it is, for the other to meet
+    Coord meet;
+    while (searching || rev.searching)
+    {
+        Branch* br = searching ? stepTouching(rev, meet) : NULL;
+        if (br) { splice(*this, br->tip, rev, rev.histAt(meet)); break; }
+        if (result.found) { break; } //Reached the find alone
+        br = rev.searching ? rev.stepTouching(*this, meet) : NULL;
+        if (br) { splice(*this, histAt(meet), rev, br->tip); break; }
+        if (rev.result.found) //Reached the start alone: its path is to next to the start, so lead in from the start
+        {
+            histPath.assign(1, Start);
+            histPath.insert(histPath.end(), rev.result.path.rbegin(), rev.result.path.rend());
+            splice(*this, NOHIST, rev, NOHIST);
+            break;
+        }
+    }
+    searching = false;
+    result.branches = branches + rev.branches;
+    result.steps = steps + rev.steps;
+}
+
+Branch* PathFinder::stepTouching(const PathFinder& other, Coord& meet)
+{
+    steps++;
+    Branch* br = pick();
+    if (!br) { return NULL; }
+    Branch* b2 = advance(br);
+    queue(br);
+    if (b2) { queue(b2); }
+    Branch* moved[2] = {br, b2};
+    for (uint m = 0; m < 2 && moved[m]; m++)
+    {
+        if (moved[m]->dead) { continue; }
+        uint by = moved[m]->y, bx = moved[m]->x;
+        for (uint y = by - 1; y != by + 2; y++) //The 3x3 cells around, as searches heading past each other are often a diagonal apart
+        {
+            for (uint x = bx - 1; x != bx + 2; x++)
+            {
+                if (y >= board.h || x >= board.w || !other.bBeen.get(y, x)) { continue; }
+                if (y == by || x == bx || !board.get(by, x) || !board.get(y, bx)) { meet = {y, x}; return moved[m]; } //Diagonal: only through an open corner
+            }
+        }
+    }
+    return NULL;
+}
+
+uint PathFinder::histAt(Coord c) const
+{
+    for (uint n = hist.size(); n--; ) { if (hist[n].y == c.y && hist[n].x == c.x) { return n; } }
+    return NOHIST;
+}
+
+void PathFinder::splice(const PathFinder& fwd, uint f, const PathFinder& rev, uint r)
+{
+  //Lay out the forward history up to f, then the reverse history back from r to the find (unless laid out already)
+    if (f != NOHIST || r != NOHIST)
+    {
+        histPath.clear();
+        for (uint n = f; n != NOHIST; n = fwd.hist[n].parent) { histPath.push_back({fwd.hist[n].y, fwd.hist[n].x}); }
+        std::reverse(histPath.begin(), histPath.end());
+        Coord a = histPath.back(), b = {rev.hist[r].y, rev.hist[r].x};
+        if (a.y != b.y && a.x != b.x) { histPath.push_back(board.get(a.y, b.x) ? Coord{b.y, a.x} : Coord{a.y, b.x}); } //Round the corner between them
+        for (uint n = r; n != NOHIST; n = rev.hist[n].parent) { histPath.push_back({rev.hist[n].y, rev.hist[n].x}); }
+    }
+  //End it on reaching the find, or next to it, as a search from the start would
+    for (uint i = 0; i < histPath.size(); i++)
+    {
+        if (adjacentTo(histPath[i].y, histPath[i].x, find.y, find.x)) { histPath.resize(i + 1); break; }
+    }
+    STAT(std::chrono::steady_clock::time_point tracing = std::chrono::steady_clock::now());
+    searching = false;
+    result.found = true;
+    result.origLen = histPath.size();
+    result.path.clear();
+    cutLoops();
+    STAT(finishStats(tracing));
+}
+
+bool PathFinder::cellChanged(uint y, uint x)
+{
+    hpa.cellChanged(y, x);
+    field.cellChanged(y, x);
+    components.cellChanged(y, x);
+    cache.cellChanged(y, x, board.get(y, x));
+    if (engine != ENGINE_DLITE || !replanner.planned) { return false; }
+    replanner.cellChanged(y, x);
+    result.found = replanner.replan(result.path);
+    result.origLen = result.path.size();
+    result.steps = replanner.expanded;
+    return true;
+}
+
+bool PathFinder::startMoved(Coord Start)
+{
+    if (engine != ENGINE_DLITE || !replanner.planned) { return false; }
+    start = Start;
+    replanner.moveStart(Start);
+    result.found = replanner.replan(result.path);
+    result.origLen = result.path.size();
+    result.steps = replanner.expanded;
+    return true;
+}
+
+void PathFinder::boardChanged()
+{
+    hpa.built = false;
+    field.built = false;
+    components.built = false;
+    cache.boardChanged();
+    replanner.planned = false;
+}
+
+Branch* PathFinder::newBranch(uint y, uint x, Branch* b)
+{
+    Branch* B;
+    if (rounding) //A round leaves room in the pool for a split from each of its branches, and never makes an initial one
+    {
+        B = &branch[__atomic_fetch_add(&branches, 1, __ATOMIC_RELAXED)];
+        B->init(this, y, x, b->tip, b->h);
+        alive(1);
+        return B;
+    }
+    if (!b) { deadBStreak++; } else { deadBStreak = 0; }
+    if (branches >= branchMax || deadBStreak == DEADTIMEOUT) //Time out (Have we: run out of branch space; been creating initial branches rather a lot)?
+    {
+        timeout = true;
+        B = &branch[branchMax]; //The spare, which is never searched
+    } else {
+        B = &branch[branches];
+        branches++;
+    }
+    if (!b) //Are we working as an initial branch (with no history?)
+    {
+        B->init(this, start.y, start.x, NOHIST, 0);
+    } else {
+        B->init(this, y, x, b->tip, b->h);
+    }
+    aliveBs++;
+    return B;
+}
+
+bool PathFinder::mayMove(uint Y, uint X)
+{
+    STAT(count(result.stats.probes));
+    if (Y < 0) { return false; }
+    if (Y > board.h - 1) { return false; }
+    if (X < 0) { return false; }
+    if (X > board.w - 1) { return false; }
+    if (board.get(Y, X)) { mark(nogo, Y, X); STAT(count(result.stats.nogoMarks)); return false; }
+    if (marked(nogo, Y, X)) { return false; }
+    return true;
+}
+
+void PathFinder::queue(Branch* br) //Put an alive branch on the frontier at its current position
+{
+    uint b = br->index();
+    if (scanning || br->dead || b >= branchMax) { return; }
+    frontier.push_back({distTo(br), b, br->stamp});
+    std::push_heap(frontier.begin(), frontier.end(), std::greater<Frontier>());
+    STAT(result.stats.peakFrontier = std::max(result.stats.peakFrontier, (uint64_t)frontier.size()));
+}
+
+Branch* PathFinder::closest() //Find the closest alive branch to the find, dropping stale entries and killing 'no-go' branches on the way
+{
+    STAT(result.stats.closest++);
+    while (scanning)
+    {
+        uint b = scanClosest(&branchPos[0], &branchDead[0], branches, packPos(find.y, find.x));
+        if (b == branches) { return NULL; }
+        if (!nogo.get(branch[b].y, branch[b].x)) { return &branch[b]; }
+        branch[b].kill();
+        STAT(result.stats.stale++);
+    }
+    while (!frontier.empty())
+    {
+        Branch* br = &branch[frontier.front().b];
+        if (!br->dead && br->stamp == frontier.front().stamp)
+        {
+            if (!nogo.get(br->y, br->x)) { return br; }
+            br->kill();
+        }
+        std::pop_heap(frontier.begin(), frontier.end(), std::greater<Frontier>());
+        frontier.pop_back();
+        STAT(result.stats.stale++);
+    }
+    return NULL;
+}
+
+void PathFinder::tracePath(Branch* br) //Build the found path from history, cutting out every loop in it
+{
+  //Materialise the history, walking back from the tip
+    histPath.resize(br->h);
+    uint n = br->tip;
+    for (uint i = br->h; i--; n = hist[n].parent) { histPath[i] = {hist[n].y, hist[n].x}; }
+    cutLoops();
+}
+
+void PathFinder::cutLoops()
+{
+    std::vector<Coord>& full = histPath;
+    uint ilen = full.size();
+  //Note the last time the history is at each position
+    for (uint i = 0; i < ilen; i++) { lastSeen.at(full[i].y, full[i].x) = i + 1; }
+  //From each point, skip on to the last time the history is at it, then to the last time it is next to it
+    for (uint i = 0; i < ilen; )
+    {
+        uint y = full[i].y, x = full[i].x;
+        i = lastSeen.get(y, x) - 1;
+        result.path.push_back({y, x});
+        uint next = i + 1; //As a last-seen value: the index after i
+        if (y > 0) { next = std::max(next, lastSeen.get(y - 1, x)); }
+        if (x + 1 < board.w) { next = std::max(next, lastSeen.get(y, x + 1)); }
+        if (y + 1 < board.h) { next = std::max(next, lastSeen.get(y + 1, x)); }
+        if (x > 0) { next = std::max(next, lastSeen.get(y, x - 1)); }
+        if (next == i + 1) { break; } //Nowhere later to go: this is the tip
+        i = next - 1;
+    }
+    for (uint i = 0; i < ilen; i++) { lastSeen.at(full[i].y, full[i].x) = 0; }
+    if (straighten) { pullString(); }
+}
+
+SearchState PathFinder::run(uint maxSteps, uint maxMicros)
+{
+    std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::microseconds(maxMicros);
+    for (uint n = 1; searching; n++)
+    {
+        step();
+        if (!searching) { break; }
+        if (n == maxSteps || (maxMicros && !(n & 15) && std::chrono::steady_clock::now() >= until)) //Out of budget? (The clock is only read every 16 steps)
+        {
+          //Give the path of the branch closest to the find, as step #2 would choose it
+            result.path.clear();
+            Branch* br = closest();
+            if (br) { tracePath(br); }
+            result.origLen = br ? br->h : 0;
+            result.branches = branches;
+            result.steps = steps;
+            return SEARCH_RUNNING;
+        }
+    }
+    return result.found ? SEARCH_FOUND : SEARCH_FAILED;
+}
+
+void PathFinder::finishStats(std::chrono::steady_clock::time_point searched) //Fill in the timings and memory of the search just ended, which has traced its path since searched
+{
+    result.stats.searchNs = std::chrono::duration_cast<std::chrono::nanoseconds>(searched - began).count();
+    result.stats.totalNs = nsSince(began);
+    result.stats.traceNs = result.stats.totalNs - result.stats.searchNs;
+    result.stats.totalNs += result.stats.cleanNs;
+    result.stats.peakBytes = branches * sizeof(Branch) + hist.size() * sizeof(HistNode) + result.stats.peakFrontier * sizeof(Frontier);
+}
+
+bool PathFinder::lineClear(Coord a, Coord b, std::vector<Coord>* cells) //Walk the 4-connected line from a to b, giving its cells after a, until it meets a block
+{
+    int dy = (int)b.y - (int)a.y, dx = (int)b.x - (int)a.x;
+    int sy = dy > 0 ? 1 : -1, sx = dx > 0 ? 1 : -1;
+    uint ny = std::abs(dy), nx = std::abs(dx);
+    uint y = a.y, x = a.x;
+    for (uint iy = 0, ix = 0; iy < ny || ix < nx; )
+    {
+      //Step along whichever axis keeps us nearest the line through the cell centres
+        if ((1 + 2 * ix) * ny < (1 + 2 * iy) * nx) { x += sx; ix++; } else { y += sy; iy++; }
+        if (board.get(y, x)) { return false; }
+        if (cells) { cells->push_back({y, x}); }
+    }
+    return true;
+}
+
+void PathFinder::pullString() //Replace each stretch of the path with a straight line, for as far ahead as the line is clear
+{
+  //Stretches are capped at PULLMAX points: each look ahead walks the whole line again, so this keeps it linear in the path
+  //(a 4-connected line is no shorter than a stretch heading one way, so only wiggles longer than that are left in)
+    std::vector<Coord>& loose = histPath;
+    loose.swap(result.path);
+    result.path.assign(1, loose[0]);
+    uint anchor = 0;
+    for (uint i = 1; i < loose.size(); i++)
+    {
+        if (i + 1 < loose.size() && i + 1 - anchor <= PULLMAX && lineClear(loose[anchor], loose[i + 1], NULL)) { continue; }
+        lineClear(loose[anchor], loose[i], &result.path);
+        anchor = i;
+    }
+}
+
+bool PathFinder::step()
+{
+    if (!searching) { return false; }
+    steps++;
+    Branch* br = pick();
+    if (!br) { return searching; }
+    Branch* b2 = advance(br);
+    queue(br);
+    if (b2) { queue(b2); }
+    return true;
+}
+
+Branch* PathFinder::pick()
+{
+//#2    Find closest branch to the destination, from the frontier
+    Branch* br = closest();
+//#1    Create a branch at the start position if no other branches are alive
+    if (!br) //Create an initial/retry branch
+    {
+        queue(newBranch(start.y, start.x, NULL));
+        br = closest();
+        if (!br && !timeout) { return NULL; } //It started 'no-go' - try again
+    }
+//#3    Is this branch at the find (or timed out)?
+    if (timeout || adjacentTo(br->y, br->x, find.y, find.x)) //DID WE FIND IT?... or did we timeout?
+    {
+        searching = false;
+        result.found = !timeout;
+        result.origLen = br ? br->h : 0;
+        result.branches = branches;
+        result.steps = steps;
+        STAT(std::chrono::steady_clock::time_point tracing = std::chrono::steady_clock::now());
+        result.path.clear(); //Of any partial path given by run()
+        if (!timeout) { tracePath(br); }
+        else if (fallback) //Only reachable finds get here (see components), so this always finds the path
+        {
+            result.found = wave.search(start, find, &result.path);
+            result.origLen = result.path.size();
+        }
+        STAT(finishStats(tracing));
+        return NULL;
+    }
+    return br;
+}
+
+bool PathFinder::beginRound(std::vector<Branch*>& picked, uint width, uint band)
+{
+    picked.clear();
+    if (!searching) { return false; }
+    steps++;
+    Branch* br = pick();
+    if (!br) { return searching; }
+  //Each branch splits at most once as it advances, so only take as many as the pool has room for splits from
+    uint room = std::min(width, branchMax - branches);
+    if (!room) //Full: advance this one alone, as step() would, so the search times out as usual
+    {
+        Branch* b2 = advance(br);
+        queue(br);
+        if (b2) { queue(b2); }
+        return true;
+    }
+  //Take the closest branches, in turn, while they are within the band of the first, until one is at the find (leaving it for the next round's step #3)
+    uint64_t reach = (uint64_t)std::sqrt((double)distTo(br)) + band;
+    reach *= reach;
+    while (br && picked.size() < room && (picked.empty() || (distTo(br) <= reach && !adjacentTo(br->y, br->x, find.y, find.x))))
+    {
+        picked.push_back(br);
+        if (scanning) { branchDead[br->index()] = SCANDEAD; } //Hide it from the next scan
+        else
+        {
+            std::pop_heap(frontier.begin(), frontier.end(), std::greater<Frontier>());
+            frontier.pop_back();
+        }
+        br = closest();
+    }
+    steps += picked.size() - 1;
+  //Make everything the round may write to ready beforehand: history space, and the grid tiles around each branch
+    if (!++roundNo) { claims.clear(); roundNo = 1; }
+    histUsed = hist.size();
+    hist.resize(histUsed + picked.size() * ROUNDHIST);
+    for (uint p = 0; p < picked.size(); p++)
+    {
+        br = picked[p];
+        if (scanning) { branchDead[br->index()] = 0; }
+        claims.at(br->y, br->x) = roundNo; //Stay out of each other's way
+        uint y0 = br->y ? br->y - 1 : 0, x0 = br->x ? br->x - 1 : 0;
+        uint y1 = std::min(br->y + 1, board.h - 1), x1 = std::min(br->x + 1, board.w - 1);
+        for (uint c = 0; c < 4; c++) //The corners cover every tile of the 3x3 cells around
+        {
+            uint y = c & 1 ? y1 : y0, x = c & 2 ? x1 : x0;
+            nogo.touch(y, x);
+            bShad.touch(y, x);
+            bBeen.touch(y, x);
+            grave.touch(y, x);
+            claims.at(y, x);
+        }
+    }
+    rounding = true;
+    return true;
+}
+
+void PathFinder::endRound(const std::vector<Branch*>& picked, const std::vector<Branch*>& born)
+{
+    rounding = false;
+    hist.resize(histUsed);
+    for (uint p = 0; p < picked.size(); p++)
+    {
+        queue(picked[p]);
+        if (born[p]) { queue(born[p]); deadBStreak = 0; }
+    }
+}
+
+uint PathFinder::addHist(uint y, uint x, uint parent)
+{
+    if (!rounding)
+    {
+        hist.push_back({y, x, parent});
+        return hist.size() - 1;
+    }
+    uint n = __atomic_fetch_add(&histUsed, 1, __ATOMIC_RELAXED);
+    hist[n] = {y, x, parent};
+    return n;
+}
+
+bool PathFinder::claim(uint Y, uint X) //Claim a cell to move into this round, returning false if another branch has
+{
+    uint* c = &claims.at(Y, X); //Its tile was touched as the round began
+    uint seen = __atomic_load_n(c, __ATOMIC_RELAXED);
+    return seen != roundNo && __atomic_compare_exchange_n(c, &seen, roundNo, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+Branch* PathFinder::advance(Branch* br)
+{
+    bool moved;
+    uint prevY, prevX;
+    byte aimY, aimX;
+    Branch* b2 = NULL;
+    bool lost = false; //Was a cell claimed by another branch this round?
+    auto may = [&](uint Y, uint X) //mayMove(), also claiming the cell while rounding
+    {
+        if (!mayMove(Y, X)) { return false; }
+        if (rounding && !claim(Y, X)) { lost = true; return false; }
+        return true;
+    };
+//#4    Aim the direction to go in
+    if (br->y == find.y) { aimY = 0; } //No-move Y
+    if (br->x == find.x) { aimX = 0; } //No-move X
+    if (br->y > find.y) { aimY = 1; } //Move North
+    if (br->x < find.x) { aimX = 2; } //Move East
+    if (br->y < find.y) { aimY = 3; } //Move South
+    if (br->x > find.x) { aimX = 4; } //Move West
+//#5    Try going towards the destination
+    prevY = br->y;
+    prevX = br->x;
+    br->successful = false;
+    if (aimY == 1) //North
+    {
+        if (may(br->y - 1, br->x))
+        {
+            br->move(-1, 0);
+        }
+    }
+    if (aimX == 2) //East
+    {
+        if (may(br->y, br->x + 1))
+        {
+            br->move(0, 1);
+        }
+    }
+    if (aimY == 3) //South
+    {
+        if (may(br->y + 1, br->x))
+        {
+            br->move(1, 0);
+        }
+    }
+    if (aimX == 4) //West
+    {
+        if (may(br->y, br->x - 1))
+        {
+            br->move(0, -1);
+        }
+    }
+
+    if (lost && prevY == br->y && prevX == br->x) { return NULL; } //Beaten to a cell by another branch: wait for the next round, rather than mark here 'no-go'
+
+//#6    Check how we moved 1
+//If both axis could not be moved into, move the original branch one opposite direction, and a new branch, the other
+    if (aimX != 0 && prevX == br->x && aimY != 0 && prevY == br->y)
+    {
+        moved = false;
+      //Mark here as a nogo
+        mark(nogo, br->y, br->x);
+        STAT(count(result.stats.nogoMarks));
+
+        prevY = br->y;
+        prevX = br->x;
+
+      //Make the original branch go in the opposing X direction
+        if (aimX == 4) //To now move East
+        {
+            if (may(br->y, br->x + 1))
+            {
+                br->move(0, 1);
+                moved = true;
+            }
+        } else { //To now move West
+        	if (may(br->y, br->x - 1))
+            {
+                br->move(0, -1);
+                moved = true;
+            }
+        }
+      //If that move didn't work, we're dead!
+        if (!moved)
+        {
+            br->kill();
+        }
+      //Make a new branch go in the opposing Y direction
+        moved = false;
+        b2 = newBranch(prevY, prevX, br);
+        STAT(count(result.stats.splits6));
+        if (aimY == 1) //To now move South
+        {
+            if (may(b2->y + 1, b2->x))
+            {
+                b2->move(1, 0);
+                moved = true;
+            }
+        } else { //To now move North
+        	if (may(b2->y - 1, b2->x))
+            {
+                b2->move(-1, 0);
+                moved = true;
+            }
+        }
+        if (!moved)
+        {
+            b2->kill();
+        }
+    }
+//#7    Check how we moved 2
+  //If one axis does not need to be moved on, and the not-no-move direction cannot be moved on, the original branch should go one direction of the perpendicular axis, and a new branch, and the other
+    if ((aimY == 0 && aimX != 0 && prevX == br->x) || (aimX == 0 && aimY != 0 && prevY == br->y))
+    {
+        moved = false;
+      //Mark here as a nogo
+        mark(nogo, br->y, br->x);
+        STAT(count(result.stats.nogoMarks));
+
+        prevY = br->y;
+        prevX = br->x;
+
+        if (aimX != 0)                      //Tried moving East or West - create a branch North and South
+        {
+            if (may(br->y - 1, br->x))  //Can move original branch North?
+            {
+                br->move(-1, 0);
+                moved = true;
+            } else {                        //Kill this branch, otherwise
+                br->kill();
+            }
+          //Create a new branch, to move South
+            b2 = newBranch(prevY, prevX, br);
+            STAT(count(result.stats.splits7));
+            if (may(b2->y + 1, b2->x))  //Can move new branch South?
+            {
+                b2->move(1, 0);
+                moved = true;
+            } else {                        //Kill this branch, otherwise
+                b2->kill();
+            }
+        }
+
+        if (aimY != 0) // Tried moving North or South - create a branch East and West
+        {
+            if (may(br->y, br->x + 1))  //Can move original branch East?
+            {
+                br->move(0, 1);
+                moved = true;
+            } else {                        //Kill this branch, otherwise
+                br->kill();
+            }
+          //Create a new branch, to move West
+            b2 = newBranch(prevY, prevX, br);
+            STAT(count(result.stats.splits7));
+            if (may(b2->y, b2->x - 1))  //Can move new branch West?
+            {
+                b2->move(0, -1);
+                moved = true;
+            } else {                        //Kill this branch, otherwise
+                b2->kill();
+            }
+        }
+        
+        
+        if (!moved) //If we didn't manage to move either branch, move back on the no-move axis
+        {
+          //Resurrect the original branch
+            br->resurrect();
+          //Move it backwards
+            if (aimX == 0) //Move it backwards on Y
+            {
+                if (may(br->y + (aimY == 1 ? 1 : -1), br->x))
+                {
+                    br->move((aimY == 1 ? 1 : -1), 0, true);
+                    moved = true;
+                }
+            } else { //Move it backwards on X
+                if (may(br->y, br->x + (aimX == 4 ? 1 : -1)))
+                {
+                    br->move(0, (aimX == 4 ? 1 : -1), true);
+                    moved = true;
+                }
+            }
+            if (!moved) // If we failed to move, again, kill it again
+            {
+                br->kill();
+            }
+        }
+    }
+    return b2;
+}
+
+#endif
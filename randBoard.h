@@ -0,0 +1,86 @@
+//===================================
+//Random board generation
+//===================================
+#ifndef RANDBOARD_H
+#define RANDBOARD_H
+
+#include <time.h> //For seeding
+#include <cmath> //For math functions
+#include "pathFinder.h" //For BitGrid, Coord and euclideanDistance()
+
+//===================================
+//For optimisation/approx/mathematical code
+//===================================
+uint g_seed = time(NULL);
+inline uint frand()
+{ 
+  g_seed = (214013 * g_seed + 2531011); 
+  return (g_seed >> 16) & 0x7FFF; 
+}
+//===================================
+
+void randBoard(BitGrid& board, char mode) //Fill the board: dense (r), square (s), light (l), maze (m) or circles (c)
+{
+    for (uint y = 0; y < board.h; y++)
+    {
+        for (uint x = 0; x < board.w; x++)
+        {
+            switch (mode)
+            {
+                case 'r':
+                    if (!(frand() % 4)) { board.set(y, x); }
+                     else { board.reset(y, x); }
+                    break;
+                case 'l':
+                    if (!(frand() % 8)) { board.set(y, x); }
+                     else { board.reset(y, x); }
+                    break;
+                case 's':
+                    if (!(y % ((frand() % 2) + 8)) != !(x % ((frand() % 2) + 16))) { board.set(y, x); }
+                     else { board.reset(y, x); }
+                    break;
+                case 'm':
+                    board.put(y, x, !((y % 2) + (x % 2)));
+                    if (frand() % 10 > 5 && (y % 2 == 0 || x % 2 == 0)) { board.set(y, x); }
+                    break;
+                case 'c':
+                    board.reset(y, x);
+                    break;
+            }
+        }
+    }
+    if (mode == 'c')
+    {
+        float step = 0.1f;
+        float angle;
+        for (uint i = 0; i < 16; i++)
+        {
+            angle = 0.0f;
+            int size = (frand() % 20) + 10, offY, offX;
+            uint y = frand() % board.h;
+            uint x = frand() % board.w;
+            while (angle < 6.28f)
+            {
+              //Calculate the x and y of this part of the circle
+                offY = (size * (float)cos(angle)) / 2;
+                offX = size * (float)sin(angle);
+              //Place obstacle
+                if (y + offY < board.h && x + offX < board.w) { board.set(y + offY, x + offX); }
+                angle += step;
+            }
+        }
+    }
+}
+
+void randEnds(const BitGrid& board, Coord& start, Coord& find) //Pick random start and find positions, at least half the board's width apart
+{
+    do
+    {
+        start.y = frand() % board.h;
+        start.x = frand() % board.w;
+        find.y = frand() % board.h;
+        find.x = frand() % board.w;
+    } while (euclideanDistance(start.y, start.x, find.y, find.x) < board.w / 2);
+}
+
+#endif
@@ -0,0 +1,88 @@
+//===================================
+//Terminal rendering, on its own frame clock
+//  - Each frame is composed into a grid of cells (character and colours), then compared with the last frame drawn
+//  - Only changed cells are written: the cursor is addressed to the start of each run of them,
+//    and colour codes are only written when the colours change from the cell before
+//  - The whole frame goes out in a single write
+//===================================
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <vector> //For the frames
+#include <string> //For the output, and the status line
+#include <chrono> //For the frame clock
+#include <stdio.h> //For writing the output
+#include "grid.h" //For uint
+
+enum Colour { BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE };
+
+const uint FPS = 30;
+
+class Renderer
+{
+  public:
+    uint h;
+    uint w;
+
+    Renderer(uint, uint);
+    void put(uint y, uint x, char ch, Colour fg, Colour bg) { next[y * w + x] = (uint16_t)((byte)ch | fg << 8 | bg << 12); }
+    void status(const std::string& s) { nextStatus = s; }
+    bool due() const { return std::chrono::steady_clock::now() >= nextFrame; } //Is it time for the next frame?
+    void flush(); //Draw what has changed since the last frame
+    void invalidate() { redraw = true; } //The screen has been written over: draw all of the next frame
+
+  private:
+    std::vector<uint16_t> next; //Cells as they are being composed: character, then 4 bits each of foreground and background
+    std::vector<uint16_t> shown; //Cells as they were last drawn
+    std::string nextStatus;
+    std::string shownStatus;
+    std::string out;
+    bool redraw;
+    std::chrono::steady_clock::time_point nextFrame;
+    void moveTo(uint, uint);
+};
+
+Renderer::Renderer(uint H, uint W) : h(H), w(W), next(H * W, 0), shown(H * W, 0), redraw(true), nextFrame(std::chrono::steady_clock::now()) {}
+
+void Renderer::moveTo(uint y, uint x) //Rows and columns from 0
+{
+    out += "\033[" + std::to_string(y + 1) + ";" + std::to_string(x + 1) + "H";
+}
+
+void Renderer::flush()
+{
+    out.clear();
+    if (redraw) { out += "\033[0m\033[2J"; }
+    int style = -1; //The colours the terminal is writing in, if known
+    for (uint y = 0; y < h; y++)
+    {
+        bool placed = false; //Is the terminal cursor at x?
+        for (uint x = 0; x < w; x++)
+        {
+            uint16_t c = next[y * w + x];
+            if (!redraw && c == shown[y * w + x]) { placed = false; continue; }
+            if (!placed) { moveTo(y, x); placed = true; }
+            if ((c >> 8) != style)
+            {
+                style = c >> 8;
+                out += "\033[" + std::to_string(30 + (style & 15)) + ";" + std::to_string(40 + (style >> 4)) + "m";
+            }
+            out += (char)(c & 255);
+            shown[y * w + x] = c;
+        }
+    }
+    if (redraw || nextStatus != shownStatus)
+    {
+        moveTo(h, 0);
+        out += "\033[0m" + nextStatus + "\033[K";
+        shownStatus = nextStatus;
+    }
+    redraw = false;
+    nextFrame = std::chrono::steady_clock::now() + std::chrono::microseconds(1000000 / FPS);
+    if (out.empty()) { return; } //Nothing changed
+    moveTo(h + 1, 0); //Park the cursor below the board
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+}
+
+#endif
@@ -0,0 +1,260 @@
+//===================================
+//Incremental re-planning (D* Lite) for when the board changes under a path
+//  - Searches backwards from the find, so each cell keeps its cost to the find (g), and the one-step lookahead of it (rhs)
+//  - When cells are edited, only those whose costs depend on them are re-opened, and the repair spreads only as far as costs change
+//  - The start may move along the path between edits without losing the search
+//Moves are those of A*: 4-connected, or 8-connected never cutting a block's corner; reaching the find or any position N/E/S/W of it is success
+//===================================
+#ifndef REPLANNER_H
+#define REPLANNER_H
+
+#include <vector> //For the open heap and the path
+#include <algorithm> //For the open heap
+#include "grid.h" //For BitGrid and TiledGrid
+#include "aStar.h" //For move costs and directions
+
+const uint INF = (uint)-1; //Cost of an unreachable cell
+
+struct DLiteCell
+{
+    uint gen; //Plan this cell was last reached in; any other plan sees it unreached
+    uint g; //Cost to the find, as settled
+    uint rhs; //Cost to the find, by looking one step ahead
+    uint k1; //Key the cell was last opened with, to tell stale heap entries
+    uint k2;
+    bool open;
+};
+
+struct DLiteKey
+{
+    uint k1;
+    uint k2;
+    uint y;
+    uint x;
+    bool operator>(const DLiteKey& o) const { return k1 != o.k1 ? k1 > o.k1 : k2 > o.k2; }
+    bool operator<(const DLiteKey& o) const { return k1 != o.k1 ? k1 < o.k1 : k2 < o.k2; }
+};
+
+class Replanner
+{
+  public:
+    const BitGrid& board;
+    TiledGrid<DLiteCell> cells;
+    std::vector<DLiteKey> open; //Min-heap, pruned lazily
+    uint gen;
+    uint km; //Heuristic drift from moves of the start
+    uint expanded; //Cells expanded by the last plan or replan
+    Coord start;
+    Coord find;
+    bool diagonal;
+    bool planned;
+
+    Replanner(const BitGrid&);
+    bool plan(Coord, Coord, bool, std::vector<Coord>&); //Plan from start to find, 8-connected or not, giving the path
+    void moveStart(Coord); //The start has moved (along the path, usually)
+    void cellChanged(uint, uint); //A cell of the board has been blocked or cleared
+    bool replan(std::vector<Coord>&); //Repair the plan after changes, giving the new path
+
+  private:
+    bool walkable(uint y, uint x) const { return y < board.h && x < board.w && !board.get(y, x); }
+    bool isGoal(uint y, uint x) const { return adjacentTo(y, x, find.y, find.x); }
+    bool isStart(uint y, uint x) const { return y == start.y && x == start.x; }
+    DLiteCell& cell(uint, uint); //A cell, reset if it was last reached in another plan
+    uint heuristic(uint, uint) const; //From the start to a cell
+    uint cost(uint, uint, uint) const; //Of moving from a cell in a direction, or INF
+    DLiteKey key(uint, uint);
+    void updateCell(uint, uint);
+    void search();
+    bool buildPath(std::vector<Coord>&);
+};
+
+Replanner::Replanner(const BitGrid& Board) : board(Board), gen(0), km(0), expanded(0), diagonal(false), planned(false) {}
+
+DLiteCell& Replanner::cell(uint y, uint x)
+{
+    DLiteCell& c = cells.at(y, x);
+    if (c.gen != gen)
+    {
+        c.gen = gen;
+        c.g = c.rhs = INF;
+        c.open = false;
+    }
+    return c;
+}
+
+uint Replanner::heuristic(uint y, uint x) const
+{
+    uint dy = y > start.y ? y - start.y : start.y - y;
+    uint dx = x > start.x ? x - start.x : start.x - x;
+    if (!diagonal) { return (dy + dx) * STRAIGHT; } //Manhattan
+    uint lo = std::min(dy, dx), hi = std::max(dy, dx);
+    return lo * DIAGONAL + (hi - lo) * STRAIGHT; //Octile
+}
+
+uint Replanner::cost(uint y, uint x, uint d) const //Only the start may be left from a block, as in A*
+{
+    if (!walkable(y + dirY[d], x + dirX[d])) { return INF; }
+    if (d < 4) { return STRAIGHT; }
+    if (!walkable(y + dirY[d], x) || !walkable(y, x + dirX[d])) { return INF; } //Never cut a corner
+    return DIAGONAL;
+}
+
+DLiteKey Replanner::key(uint y, uint x)
+{
+    DLiteCell& c = cell(y, x);
+    uint m = std::min(c.g, c.rhs);
+    return {m == INF ? INF : m + heuristic(y, x) + km, m, y, x};
+}
+
+void Replanner::updateCell(uint y, uint x) //Recompute a cell's lookahead, and open it if that disagrees with its settled cost
+{
+    DLiteCell& c = cell(y, x);
+    if (!walkable(y, x) && !isStart(y, x))
+    {
+        c.rhs = INF;
+    } else if (!isGoal(y, x)) {
+        c.rhs = INF;
+        uint dirs = diagonal ? 8 : 4;
+        for (uint d = 0; d < dirs; d++)
+        {
+            uint step = cost(y, x, d);
+            if (step == INF) { continue; }
+            uint g = cell(y + dirY[d], x + dirX[d]).g;
+            if (g != INF && g + step < c.rhs) { c.rhs = g + step; }
+        }
+    } else {
+        c.rhs = 0;
+    }
+    bool wasOpen = c.open;
+    c.open = c.g != c.rhs;
+    if (c.open)
+    {
+        DLiteKey k = key(y, x);
+        if (wasOpen && c.k1 == k.k1 && c.k2 == k.k2) { return; } //Already queued as it is
+        c.k1 = k.k1;
+        c.k2 = k.k2;
+        open.push_back(k);
+        std::push_heap(open.begin(), open.end(), std::greater<DLiteKey>());
+    }
+}
+
+void Replanner::search() //Settle cells until the start's cost is right
+{
+    uint dirs = diagonal ? 8 : 4;
+    while (!open.empty())
+    {
+        DLiteKey top = open.front();
+        DLiteCell& c = cell(top.y, top.x);
+        if (!c.open || c.k1 != top.k1 || c.k2 != top.k2) //Stale
+        {
+            std::pop_heap(open.begin(), open.end(), std::greater<DLiteKey>());
+            open.pop_back();
+            continue;
+        }
+        DLiteCell& s = cell(start.y, start.x);
+        if (!(top < key(start.y, start.x)) && s.rhs == s.g) { break; }
+        std::pop_heap(open.begin(), open.end(), std::greater<DLiteKey>());
+        open.pop_back();
+        expanded++;
+        DLiteKey now = key(top.y, top.x);
+        if (top < now) //The start has moved since it was opened
+        {
+            c.k1 = now.k1;
+            c.k2 = now.k2;
+            open.push_back(now);
+            std::push_heap(open.begin(), open.end(), std::greater<DLiteKey>());
+            continue;
+        }
+        c.open = false;
+        if (c.g > c.rhs) { c.g = c.rhs; } //Cheaper: settle it
+        else { c.g = INF; updateCell(top.y, top.x); } //Dearer: unsettle it, and have it look again
+      //Its neighbours may now reach the find through it, or no longer can
+        for (uint d = 0; d < dirs; d++)
+        {
+            uint ny = top.y + dirY[d], nx = top.x + dirX[d];
+            if (ny < board.h && nx < board.w) { updateCell(ny, nx); }
+        }
+    }
+}
+
+bool Replanner::buildPath(std::vector<Coord>& path) //Walk downhill from the start to the find
+{
+    path.clear();
+    uint y = start.y, x = start.x;
+    if (cell(y, x).g == INF) { return false; }
+    uint dirs = diagonal ? 8 : 4;
+    path.push_back({y, x});
+    while (!isGoal(y, x))
+    {
+        uint best = INF, by = y, bx = x;
+        for (uint d = 0; d < dirs; d++)
+        {
+            uint step = cost(y, x, d);
+            if (step == INF) { continue; }
+            uint g = cell(y + dirY[d], x + dirX[d]).g;
+            if (g != INF && g + step < best) { best = g + step; by = y + dirY[d]; bx = x + dirX[d]; }
+        }
+        if (best == INF || path.size() > board.h * board.w) { path.clear(); return false; }
+        y = by;
+        x = bx;
+        path.push_back({y, x});
+    }
+    return true;
+}
+
+bool Replanner::plan(Coord Start, Coord Find, bool Diagonal, std::vector<Coord>& path)
+{
+    start = Start;
+    find = Find;
+    diagonal = Diagonal;
+    km = 0;
+    expanded = 0;
+    planned = true;
+    if (cells.h != board.h || cells.w != board.w) { cells.resize(board.h, board.w); gen = 0; }
+    if (!++gen) { cells.clear(); gen = 1; } //Wrapped: forget every earlier plan
+    open.clear();
+  //The find and each position N/E/S/W of it are where the backward search begins
+    int around[5][2] = {{0, 0}, {-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (uint a = 0; a < 5; a++)
+    {
+        uint y = find.y + around[a][0], x = find.x + around[a][1];
+        if (y < board.h && x < board.w) { updateCell(y, x); }
+    }
+    search();
+    return buildPath(path);
+}
+
+void Replanner::moveStart(Coord Start)
+{
+    Coord old = start;
+    km += heuristic(Start.y, Start.x); //The old start's heuristic to the new start
+    start = Start;
+    if (!planned) { return; }
+    updateCell(old.y, old.x); //Either may be a block, which only the start may leave
+    updateCell(start.y, start.x);
+}
+
+void Replanner::cellChanged(uint y, uint x)
+{
+    if (!planned) { return; }
+  //Only moves into, out of, or (diagonally) around the cell change cost
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            if (!diagonal && dy && dx) { continue; }
+            uint ny = y + dy, nx = x + dx;
+            if (ny < board.h && nx < board.w) { updateCell(ny, nx); }
+        }
+    }
+}
+
+bool Replanner::replan(std::vector<Coord>& path)
+{
+    expanded = 0;
+    if (!planned) { path.clear(); return false; }
+    search();
+    return buildPath(path);
+}
+
+#endif
@@ -0,0 +1,55 @@
+//===================================
+//Per-query counters and timings, kept in each PathResult
+//Build with -DPATFIND_NOSTATS to take every count and timing out of the search; the fields then stay zero
+//===================================
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h> //For uint64_t
+#include <string> //For JSON
+#include <chrono> //For timing
+
+#ifndef PATFIND_NOSTATS
+#define STAT(...) __VA_ARGS__
+#else
+#define STAT(...)
+#endif
+
+struct SearchStats
+{
+    uint64_t probes; //mayMove() calls
+    uint64_t splits6; //New branches from step #6 (both axes blocked)
+    uint64_t splits7; //New branches from step #7 (the one axis to move on blocked)
+    uint64_t kills;
+    uint64_t resurrects;
+    uint64_t nogoMarks;
+    uint64_t closest; //Look-ups of the closest branch (step #2)
+    uint64_t stale; //Frontier entries dropped as stale, dead or 'no-go'
+    uint64_t peakFrontier; //Most entries on the frontier at once
+    uint64_t peakBytes; //Most memory held by branches, history and the frontier
+    uint64_t cleanNs; //Resetting the search state
+    uint64_t searchNs; //From the search beginning to it ending (for A*, JPS and D* Lite, the whole search)
+    uint64_t traceNs; //Building the found path from history
+    uint64_t totalNs;
+    std::string json() const;
+};
+
+inline uint64_t nsSince(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t).count();
+}
+
+std::string SearchStats::json() const
+{
+    const char* names[] = {"probes", "splits6", "splits7", "kills", "resurrects", "nogoMarks", "closest", "stale", "peakFrontier", "peakBytes", "cleanNs", "searchNs", "traceNs", "totalNs"};
+    const uint64_t values[] = {probes, splits6, splits7, kills, resurrects, nogoMarks, closest, stale, peakFrontier, peakBytes, cleanNs, searchNs, traceNs, totalNs};
+    std::string s = "{";
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        if (i) { s += ", "; }
+        s += std::string("\"") + names[i] + "\": " + std::to_string(values[i]);
+    }
+    return s + "}";
+}
+
+#endif
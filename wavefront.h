@@ -0,0 +1,169 @@
+//===================================
+//Exact breadth-first search, 64 cells at a time
+//  - The open cells of each row are packed into 64 bit words, as the board holds them. A layer of the search is a bit per cell:
+//    each frontier word spreads to its own word shifted left and right (carrying in from the words beside it) and to the words
+//    above and below, masked by the open cells not yet reached
+//  - Only the words with a cell on the frontier are spread, so a layer costs its own size rather than the board's.
+//    Rows are padded with a zero word either side, and a zero row above and below, so spreading has no edge cases
+//  - Each layer's words are kept (for a path), each linked to the same word in an earlier layer, and the path is read back
+//    from them: from the cell reached last, step to any neighbour on the layer before, down to the start. As it only goes down,
+//    each word's link is followed back past the layers already read, so finding a neighbour's word in a layer costs O(1) overall
+//Moves are 4-connected; reaching the find or any position N/E/S/W of it is success, and the start may be left from a block
+//It is complete and optimal: it reports no path only when there is none
+//===================================
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <vector> //For the packed rows, the layers and the path
+#include <stdint.h> //For uint64_t
+#include "grid.h" //For BitGrid
+#include "aStar.h" //For directions
+
+const uint NOFRONT = (uint)-1; //No earlier entry of a word in the layers
+
+class WaveFront
+{
+  public:
+    const BitGrid& board;
+    uint expanded; //Frontier words spread in the last search
+
+    WaveFront(const BitGrid&);
+    bool search(Coord, Coord, std::vector<Coord>*); //From the start to (next to) the find, giving the path if asked for it
+    int distance(Coord start, Coord find) { return search(start, find, NULL) ? layers : -1; } //Cells on the shortest path, or -1
+
+  private:
+    uint stride; //Words per row, with a zero word either side
+    std::vector<uint64_t> open; //Open cells, a row of words at a time, with a zero row above and below
+    std::vector<uint64_t> reached;
+    std::vector<uint64_t> next; //The layer being spread into
+    std::vector<uint> nextAt; //Indexes of its words that are set
+    std::vector<uint> frontAt; //Every layer's set words, one after another
+    std::vector<uint64_t> frontBits;
+    std::vector<uint> layerStart; //Where each layer begins in frontAt
+    std::vector<uint> prevAt; //For each entry of frontAt, the same word's entry in an earlier layer (for a path)
+    std::vector<uint> lastAt; //Per word, its newest entry in frontAt not yet read back past (for a path)
+    uint layers; //In the last search, counting the start's
+
+    void spread(uint i, uint64_t bits) //Into word i of the next layer
+    {
+        bits &= open[i] & ~reached[i];
+        if (!bits) { return; }
+        if (!next[i]) { nextAt.push_back(i); }
+        next[i] |= bits;
+    }
+    uint at(uint y, uint x) const { return (y + 1) * stride + (x >> 6) + 1; } //Index of the word holding a cell
+    bool inLayer(uint, uint, uint);
+};
+
+WaveFront::WaveFront(const BitGrid& Board) : board(Board), expanded(0), stride(0), layers(0) {}
+
+bool WaveFront::search(Coord start, Coord find, std::vector<Coord>* path)
+{
+    expanded = 0;
+    layers = 1;
+    if (path) { path->assign(1, start); }
+    if (adjacentTo(start.y, start.x, find.y, find.x)) { return true; }
+  //Pack the open cells
+    uint words = (board.w + 63) >> 6;
+    stride = words + 2;
+    open.assign((board.h + 2) * stride, 0);
+    for (uint y = 0; y < board.h; y++)
+    {
+        uint64_t* row = &open[at(y, 0)];
+        for (uint wx = 0; wx < words; wx++) { row[wx] = ~board.word(y, wx); }
+        if (board.w & 63) { row[words - 1] &= ((uint64_t)1 << (board.w & 63)) - 1; }
+    }
+    reached.assign(open.size(), 0);
+    next.assign(open.size(), 0);
+  //The cells that end the search
+    uint goalAt[5];
+    uint64_t goalBits[5];
+    uint goals = 0;
+    const int around[5][2] = {{0, 0}, {-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (uint a = 0; a < 5; a++)
+    {
+        uint y = find.y + around[a][0], x = find.x + around[a][1];
+        if (y >= board.h || x >= board.w || board.get(y, x)) { continue; }
+        goalAt[goals] = at(y, x);
+        goalBits[goals++] = (uint64_t)1 << (x & 63);
+    }
+    if (!goals) { if (path) { path->clear(); } return false; }
+  //Spread a layer at a time from the start, a frontier word at a time
+    uint s = at(start.y, start.x);
+    reached[s] = (uint64_t)1 << (start.x & 63);
+    frontAt.assign(1, s);
+    frontBits.assign(1, reached[s]);
+    layerStart.assign(1, 0);
+    if (path)
+    {
+        lastAt.assign(open.size(), NOFRONT);
+        lastAt[s] = 0;
+        prevAt.assign(1, NOFRONT);
+    }
+    uint end = goals; //The goal reached, once there is one
+    while (end == goals)
+    {
+        uint from = layerStart.back(), to = frontAt.size();
+        if (from == to) { if (path) { path->clear(); } return false; } //Nothing left to reach
+        nextAt.clear();
+        for (uint f = from; f < to; f++)
+        {
+            uint i = frontAt[f];
+            uint64_t bits = frontBits[f];
+            spread(i, bits << 1 | bits >> 1);
+            spread(i + 1, bits >> 63);
+            spread(i - 1, bits << 63);
+            spread(i - stride, bits);
+            spread(i + stride, bits);
+        }
+        expanded += to - from;
+        layerStart.push_back(frontAt.size());
+        for (uint n = 0; n < nextAt.size(); n++)
+        {
+            uint i = nextAt[n];
+            reached[i] |= next[i];
+            if (path)
+            {
+                prevAt.push_back(lastAt[i]);
+                lastAt[i] = frontAt.size();
+            }
+            frontAt.push_back(i);
+            frontBits.push_back(next[i]);
+            next[i] = 0;
+        }
+        if (!path) //Only the newest layer is needed: drop the ones before
+        {
+            frontAt.erase(frontAt.begin(), frontAt.begin() + layerStart.back());
+            frontBits.erase(frontBits.begin(), frontBits.begin() + layerStart.back());
+            layerStart.assign(1, 0);
+        }
+        layers++;
+        for (uint g = 0; g < goals && end == goals; g++) { if (reached[goalAt[g]] & goalBits[g]) { end = g; } }
+    }
+    if (!path) { return true; }
+  //Read the path back, a layer at a time
+    uint gy = goalAt[end] / stride - 1;
+    uint gx = ((goalAt[end] % stride - 1) << 6) + __builtin_ctzll(goalBits[end]);
+    path->resize(layers);
+    (*path)[layers - 1] = {gy, gx};
+    for (uint l = layers - 1; l-- > 1; )
+    {
+        Coord c = (*path)[l + 1];
+        for (uint d = 0; d < 4; d++)
+        {
+            uint ny = c.y + dirY[d], nx = c.x + dirX[d];
+            if (ny < board.h && nx < board.w && inLayer(l, ny, nx)) { (*path)[l] = {ny, nx}; break; }
+        }
+    }
+    return true;
+}
+
+bool WaveFront::inLayer(uint l, uint y, uint x) //Is a cell on a layer's frontier? Layers must be asked about from the last down
+{
+    uint to = l + 1 < layerStart.size() ? layerStart[l + 1] : frontAt.size();
+    uint& f = lastAt[at(y, x)];
+    while (f != NOFRONT && f >= to) { f = prevAt[f]; } //Back past the layers after this one, for good
+    return f != NOFRONT && f >= layerStart[l] && frontBits[f] >> (x & 63) & 1;
+}
+
+#endif